@@ -0,0 +1,44 @@
+# Makes every symbol of a SIMD solver variant's object file local except the variant's entry
+# points, e.g., TdokuSolveBatch_avx2. Inline functions and template instantiations, including
+# those of the standard library, are otherwise emitted as weak symbols that the linker merges
+# across object files, and it could keep this variant's copy, compiled for a newer instruction
+# set, for callers in the baseline objects or in another variant.
+#
+# cmake -DINPUT=<object> -DOUTPUT=<object> -DVARIANT=<name> -DLINKER=<ld> -DOBJCOPY=<objcopy>
+#       -DNM=<nm> -P localize_simd_variant.cmake
+
+# a partial link takes the members out of their COMDAT groups so they can't be discarded in
+# favor of another object's copy.
+execute_process(COMMAND ${LINKER} -r --force-group-allocation -o ${OUTPUT}.partial ${INPUT}
+                RESULT_VARIABLE result)
+if(result)
+    message(FATAL_ERROR "partial link of the ${VARIANT} variant failed")
+endif()
+execute_process(COMMAND ${OBJCOPY} --wildcard --keep-global-symbol=Tdoku*_${VARIANT}
+                        ${OUTPUT}.partial ${OUTPUT}
+                RESULT_VARIABLE result)
+file(REMOVE ${OUTPUT}.partial)
+if(result)
+    message(FATAL_ERROR "localizing the symbols of the ${VARIANT} variant failed")
+endif()
+
+# check that the entry points are the only global definitions left.
+execute_process(COMMAND ${NM} -g --defined-only ${OUTPUT}
+                OUTPUT_VARIABLE symbols RESULT_VARIABLE result)
+if(result)
+    message(FATAL_ERROR "listing the symbols of the ${VARIANT} variant failed")
+endif()
+string(REPLACE "\n" ";" symbols "${symbols}")
+set(num_entry_points 0)
+foreach(line ${symbols})
+    if(line MATCHES " Tdoku[A-Za-z0-9]*_${VARIANT}$")
+        math(EXPR num_entry_points "${num_entry_points} + 1")
+    else()
+        file(REMOVE ${OUTPUT})
+        message(FATAL_ERROR "the ${VARIANT} variant still defines a global symbol: ${line}")
+    endif()
+endforeach()
+if(num_entry_points EQUAL 0)
+    file(REMOVE ${OUTPUT})
+    message(FATAL_ERROR "the ${VARIANT} variant defines no entry points")
+endif()
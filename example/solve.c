@@ -3,20 +3,40 @@
 #include <stdlib.h>
 #include <string.h>
 
+#define CHUNK 65536
+
 int main(int argc, const char **argv) {
     size_t limit = argc > 1 ? atoll(argv[1]) : 10000;
+    int num_threads = argc > 2 ? atoi(argv[2]) : 1;
 
-    char *puzzle = NULL;
-    char solution[81];
-    size_t size, guesses;
+    static char puzzles[CHUNK * 82];
+    static char solutions[CHUNK * 81];
+    static uint32_t counts[CHUNK];
+    char *line = NULL;
+    size_t size;
+    double seconds, total_seconds = 0.0;
+    int done = 0;
 
-    while (getline(&puzzle, &size, stdin) != -1) {
-        if (strlen(puzzle) < 81 || puzzle[0] == '#') continue;
-        solution[0] = '\0';
-        size_t count = SolveSudoku(puzzle, limit, 0, solution, &guesses);
-        if (limit > 1 && count == 1) {
-            SolveSudoku(puzzle, 1, 0, solution, &guesses);
+    while (!done) {
+        // read a chunk of puzzles, solve them in parallel, and print results in input order.
+        size_t num_puzzles = 0;
+        while (num_puzzles < CHUNK) {
+            if (getline(&line, &size, stdin) == -1) {
+                done = 1;
+                break;
+            }
+            if (strlen(line) < 81 || line[0] == '#') continue;
+            memcpy(&puzzles[num_puzzles * 82], line, 81);
+            puzzles[num_puzzles * 82 + 81] = '\n';
+            num_puzzles++;
+        }
+        TdokuSolveBatchParallel(puzzles, num_puzzles, 82, limit, num_threads,
+                                solutions, counts, NULL, &seconds);
+        total_seconds += seconds;
+        for (size_t i = 0; i < num_puzzles; i++) {
+            printf("%.81s:%u:%.*s\n", &puzzles[i * 82], counts[i],
+                   counts[i] == 1 ? 81 : 0, &solutions[i * 81]);
         }
-        printf("%.81s:%ld:%.81s\n", puzzle, count, solution);
     }
+    fprintf(stderr, "solved in %.3f seconds\n", total_seconds);
 }
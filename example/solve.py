@@ -9,6 +9,9 @@ class Tdoku:
         self.__solve = self.__tdoku.TdokuSolverDpllTriadSimd
         self.__solve.restype = c_ulonglong
 
+        self.__solve_batch = self.__tdoku.TdokuSolveBatch
+        self.__solve_batch.restype = c_size_t
+
         self.__constrain = self.__tdoku.TdokuConstrain
         self.__constrain.restype = c_bool
 
@@ -28,6 +31,18 @@ class Tdoku:
         else:
             return 0, "", guesses
 
+    def SolveBatch(self, puzzles, limit=2):
+        puzzles = [str.encode(p) if type(p) is str else p for p in puzzles]
+        count = len(puzzles)
+        buffer = create_string_buffer(b"".join(p[:81] for p in puzzles), count * 81)
+        solutions = create_string_buffer(count * 81)
+        counts = (c_uint32 * count)()
+        guesses = (c_uint32 * count)()
+        self.__solve_batch(buffer, c_size_t(count), c_size_t(81), c_size_t(limit),
+                           solutions, counts, guesses)
+        return [(counts[i], solutions.raw[i * 81:(i + 1) * 81].decode() if counts[i] else "",
+                 guesses[i]) for i in range(count)]
+
     def Count(self, puzzle, limit=2):
         if type(puzzle) is str:
             puzzle = str.encode(puzzle)
@@ -67,8 +82,7 @@ if __name__ == '__main__':
         filename = 'data/puzzles2_17_clue'
 
     with open(filename, 'r') as f:
-        for puzzle in f.readlines():
-            if len(puzzle) >= 81 and not puzzle.startswith('#'):
-                count, solution, guesses = tdoku.Solve(puzzle)
-                print("%.81s:%lu:%.81s:%lu" % (puzzle, count, solution, guesses))
+        puzzles = [p for p in f.readlines() if len(p) >= 81 and not p.startswith('#')]
+        for puzzle, (count, solution, guesses) in zip(puzzles, tdoku.SolveBatch(puzzles)):
+            print("%.81s:%lu:%.81s:%lu" % (puzzle, count, solution, guesses))
 
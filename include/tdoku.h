@@ -17,6 +17,65 @@ struct GenerateOut9x9{
     char data[81];
 };
 
+/**
+ * Options for TdokuGenerateScored. Fill with TdokuGenerateOptionsDefault before changing the
+ * fields of interest.
+ */
+struct GenerateOptions9x9{
+    /** Weight of the number of clues in the loss. */
+    double clue_weight;
+    /** Weight of ln(1 + mean_guesses) in the loss, subtracted so harder puzzles score better. */
+    double guess_weight;
+    /** Weight of uniform noise in [0, 1) added to the loss, to keep the pool diverse. */
+    double random_weight;
+    /** The number of clues dropped from a pattern to make each new puzzle. */
+    int clues_to_drop;
+    /** The number of random permutations solved to rate a puzzle. */
+    int num_evals;
+    /** Bounds on the number of clues of the puzzles returned, 0 for no bound. */
+    uint32_t min_clues;
+    uint32_t max_clues;
+    /** Bounds on the rating of the puzzles returned, on the scale of TdokuRate, 0 for no bound. */
+    int min_rating;
+    int max_rating;
+    /**
+     * The size in bytes of a filter rejecting puzzles equivalent to one generated before in the
+     * same call, as TdokuGeneratorSetDedup sets up, or 0 to keep them. Ignored by
+     * TdokuGeneratorGenerateScored, which uses the generator's own filter.
+     */
+    size_t dedup_bytes;
+};
+
+/**
+ * An opaque handle owning solver instances, a random number generator and scratch space, so
+ * that repeated calls don't pay for setting these up on every call. A context must not be
+ * used by more than one thread at a time, use one context per thread instead.
+ */
+typedef struct TdokuContext TdokuContext;
+
+/**
+ * An opaque handle for a search over the solutions of one puzzle that pauses after each
+ * solution, see TdokuSearchCreate.
+ */
+typedef struct TdokuSearch TdokuSearch;
+
+/**
+ * An opaque handle for a puzzle generator whose pattern pool persists between calls, see
+ * TdokuGeneratorCreate. Like a context, it must not be used by more than one thread at a time.
+ */
+typedef struct TdokuGenerator TdokuGenerator;
+
+/**
+ * An opaque handle for a cache of solve and rate results, see TdokuCacheCreate. Unlike a
+ * context, a cache may be shared by any number of threads.
+ */
+typedef struct TdokuCache TdokuCache;
+
+/**
+ * The number of features written by TdokuRateFeatures.
+ */
+#define TDOKU_NUM_RATE_FEATURES 11
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -73,6 +132,65 @@ size_t TdokuEnumerate(const char *input,
                       void (*callback)(const char *, void *),
                       void *callback_arg);
 
+/**
+ * Counts the solutions to a given Sudoku or Pencilmark Sudoku puzzle, searching separate parts
+ * of the search tree on several threads. This pays off for puzzles with many solutions, like
+ * grid patterns; for puzzles with few solutions use TdokuSolverDpllTriadSimd.
+ * @param input
+ *      Same as TdokuSolveImpl
+ * @param limit
+ *      The maximum number of solutions to count. Threads may search past the limit
+ *      before they notice it was reached, but the count returned never exceeds it.
+ * @param num_threads
+ *      The number of threads to use, or 0 for one per hardware thread.
+ * @param num_guesses
+ *      Optional out parameter to receive the total number of guesses of all threads.
+ * @return
+ *      The number of solutions found up to the given limit.
+ */
+size_t TdokuCountParallel(const char *input, size_t limit, int num_threads,
+                          size_t *num_guesses);
+
+/**
+ * Like TdokuEnumerate, but searches separate parts of the search tree on several threads.
+ * The callback is called from the worker threads, though never by two at once, and the
+ * solutions don't arrive in the order TdokuEnumerate reports them.
+ * @param num_threads
+ *      The number of threads to use, or 0 for one per hardware thread.
+ * @return
+ *      The number of solutions reported, at most limit.
+ */
+size_t TdokuEnumerateParallel(const char *input, size_t limit, int num_threads,
+                              void (*callback)(const char *, void *), void *callback_arg);
+
+/**
+ * Starts a search over the solutions to a given Sudoku or Pencilmark Sudoku puzzle that runs
+ * only when asked for the next solution, so the caller can stop and continue it at will. The
+ * search keeps its position on a preallocated stack and uses little of the caller's stack.
+ * @param input
+ *      Same as TdokuSolveImpl
+ * @return
+ *      A search to pass to TdokuSearchNext and TdokuSearchDestroy, or null if out of memory.
+ */
+TdokuSearch *TdokuSearchCreate(const char *input);
+
+/**
+ * Continues a search until it finds its next solution. Solutions come in the same order
+ * TdokuEnumerate reports them.
+ * @param solution
+ *      Pointer to an 81 character array to receive the solution.
+ * @param num_guesses
+ *      Optional out parameter to receive the number of guesses made during this call.
+ * @return
+ *      A boolean indicating whether there was another solution.
+ */
+bool TdokuSearchNext(TdokuSearch *search, char *solution, size_t *num_guesses);
+
+/**
+ * Destroys a search created by TdokuSearchCreate. Passing null is allowed.
+ */
+void TdokuSearchDestroy(TdokuSearch *search);
+
 /**
  * Given a partially constrained puzzle adds random clues until the solution is unique. This
  * procedure is fast, but biased in the sense that different puzzles may arise with widely
@@ -101,6 +219,34 @@ bool TdokuConstrain(bool pencilmark, char *input);
  */
 bool TdokuMinimize(bool pencilmark, bool monotonic, char *input);
 
+/**
+ * Same as TdokuConstrain for a vanilla puzzle, but only adds clues where a mask allows them,
+ * and adds them by groups of symmetric cells, so that a symmetric puzzle stays symmetric.
+ * @param mask
+ *       An 81 character string in which '.' marks the cells that must not get a clue. Any
+ *       other character allows a clue. For symmetric puzzles the mask should be symmetric too.
+ * @param symmetry
+ *       The symmetry of clue groups: 0 for none, 1 for 180 degree rotation, 2 for 90 degree
+ *       rotation, 3 for a left-right mirror, 4 for a mirror in the main diagonal.
+ * @param input
+ *       Same as TdokuSolveImpl, a vanilla puzzle.
+ * @return
+ *       A boolean indicating success or failure. Fails if the allowed cells can't make the
+ *       solution unique.
+ */
+bool TdokuConstrainMasked(const char *mask, int symmetry, char *input);
+
+/**
+ * Same as TdokuMinimize for a vanilla puzzle, but only tests removal of clues where the mask
+ * allows clues, and removes them by groups of symmetric cells. A group is restored if any of
+ * its clues is required. Clues outside the mask are left in place.
+ * @param mask
+ *       Same as TdokuConstrainMasked
+ * @param symmetry
+ *       Same as TdokuConstrainMasked
+ */
+bool TdokuMinimizeMasked(const char *mask, int symmetry, bool monotonic, char *input);
+
 /**
  * Generate classic sudoku puzzles 9x9
  * @param num
@@ -118,6 +264,91 @@ bool TdokuMinimize(bool pencilmark, bool monotonic, char *input);
  */
 size_t TdokuGenerate(size_t num, bool pencilmark, uint64_t random_seed, char* buffer, char separator);
 
+/**
+ * Sets the generation options to their defaults: clue_weight 1, guess_weight 0.5,
+ * random_weight 1, 3 clues to drop, 10 evals, no bounds and no deduplication.
+ */
+void TdokuGenerateOptionsDefault(struct GenerateOptions9x9 *options);
+
+/**
+ * Generates vanilla puzzles in a difficulty window. Each new puzzle is scored with the loss
+ *
+ * clue_weight * num_clues - guess_weight * ln(1 + mean_guesses) + random_weight * noise
+ *
+ * where ln(1 + mean_guesses) is the mean of ln(1 + guesses) the SIMD solver takes over num_evals
+ * random permutations of the puzzle, as TdokuRate computes it, so a puzzle's rating is
+ * round(1000 * ln(1 + mean_guesses) / ln(9)). The best scoring puzzles replace the worst in the
+ * generator's pattern pool, so the pool evolves towards puzzles with fewer clues and more
+ * guesses. A puzzle outside the clue bounds is rejected before it's rated, and rating stops as
+ * soon as a puzzle is sure to be rated above max_rating.
+ * @param num
+ *       The number of attempts to make.
+ * @param options
+ *       The generation options, or NULL for the defaults.
+ * @param random_seed
+ *       A random seed for generator, 0 is ignored.
+ * @param output
+ *       Array of num records to receive the puzzles in the window, in the order they were found.
+ * @return
+ *       The number of records stored, up to num.
+ */
+size_t TdokuGenerateScored(size_t num, const struct GenerateOptions9x9 *options,
+                           uint64_t random_seed, struct GenerateOut9x9 *output);
+
+/**
+ * Generates puzzles like TdokuGenerate, but passes each one to a callback as soon as it's
+ * accepted instead of storing it, and keeps going until one of the limits below is reached.
+ * A limit of 0 disables it. If all three are 0 nothing is generated.
+ * @param random_seed
+ *       A random seed for generator, 0 is ignored.
+ * @param max_puzzles
+ *       Stop after this many puzzles have been accepted.
+ * @param max_attempts
+ *       Stop after this many attempts, accepted or not. TdokuGenerate makes num attempts.
+ * @param max_seconds
+ *       Stop at the first attempt starting after this much wall clock time.
+ * @param callback
+ *       Called with each puzzle, a null terminated string of 81 (or 729) characters that's
+ *       only valid during the call.
+ * @param callback_arg
+ *       An optional callback argument that will be returned as the second callback argument.
+ * @return
+ *       The number of puzzles passed to the callback.
+ */
+size_t TdokuGenerateStream(bool pencilmark, uint64_t random_seed, size_t max_puzzles,
+                           uint64_t max_attempts, double max_seconds,
+                           void (*callback)(const char *, void *), void *callback_arg);
+
+/**
+ * Same as TdokuGenerate for vanilla puzzles, but only places clues where the mask allows them,
+ * adding and removing them by groups of symmetric cells, so every puzzle fits the layout
+ * without generating freely and filtering.
+ * @param mask
+ *       Same as TdokuConstrainMasked
+ * @param symmetry
+ *       Same as TdokuConstrainMasked
+ * @param acceptance_rate
+ *       Optional (may be NULL) out parameter to receive the fraction of attempts that produced
+ *       a puzzle. Masks leaving few cells fail more often.
+ */
+size_t TdokuGenerateMasked(size_t num, const char *mask, int symmetry, uint64_t random_seed,
+                           char* buffer, char separator, double *acceptance_rate);
+
+/**
+ * Same as TdokuGenerate, but splits the attempts evenly across worker threads. Each worker has
+ * its own pattern pool and a random number generator seeded from random_seed and the worker's
+ * index, and puzzles are stored in worker order, so the output is reproducible for a given
+ * seed and thread count. With one thread the output is the same as TdokuGenerate's.
+ * @param num_threads
+ *       The number of threads to use, or 0 for one per hardware thread. Pass an explicit count
+ *       for reproducible output across machines.
+ * @return
+ *       The number of puzzles generated, up to num. They're stored contiguously at the start of
+ *       the buffer.
+ */
+size_t TdokuGenerateParallel(size_t num, bool pencilmark, uint64_t random_seed, int num_threads,
+                             char* buffer, char separator);
+
 /**
  * returns an rating of the puzzle
  * 
@@ -142,6 +373,96 @@ size_t TdokuGenerate(size_t num, bool pencilmark, uint64_t random_seed, char* bu
  */
 int TdokuRate(const char *input, bool pencilemark, int solver, int num_evals);
 
+/**
+ * Same as TdokuRate, but reproducible for a given seed and able to spread the evaluations over
+ * threads. The evaluations are split into chunks of 16, each permuting the puzzle with its own
+ * random number generator seeded from random_seed, the puzzle and the chunk's index, so the
+ * rating is the same for any number of threads. Every seed, including 0, is reproducible.
+ * @param num_threads
+ *       The number of threads to use, or 0 for one per hardware thread.
+ */
+int TdokuRateSeeded(const char *input, bool pencilmark, int solver, int num_evals,
+                    uint64_t random_seed, int num_threads);
+
+/**
+ * Same as TdokuRateSeeded on one thread, but stops evaluating once the rating is known well
+ * enough, so easy puzzles, which solve with the same number of guesses under almost every
+ * permutation, take only a few evaluations. The evaluations are drawn as by TdokuRateSeeded with
+ * the same seed.
+ * @param min_evals
+ *       The minimum number of evaluations, at least 2 are needed to estimate the error.
+ * @param max_evals
+ *       The maximum number of evaluations.
+ * @param tolerance
+ *       Stop once the standard error of the rating, i.e., of the mean log guesses in units of
+ *       rating, is at most this. The error is estimated as if one more evaluation deviated
+ *       from the rating by the rating itself, so a run of equal guess counts doesn't stop
+ *       early unless no guesses were needed.
+ * @param rating_low
+ *       Optional (may be NULL) out parameter to receive the low end of the rating's 95%
+ *       confidence interval.
+ * @param rating_high
+ *       Optional (may be NULL) out parameter to receive the high end of the rating's 95%
+ *       confidence interval.
+ * @param num_evals
+ *       Optional (may be NULL) out parameter to receive the number of evaluations used.
+ * @return
+ *       The rating.
+ */
+int TdokuRateAdaptive(const char *input, bool pencilmark, int solver, int min_evals,
+                      int max_evals, double tolerance, uint64_t random_seed, int *rating_low,
+                      int *rating_high, int *num_evals);
+
+/**
+ * Estimates the rating TdokuRate would give a vanilla puzzle from the features of its
+ * propagated state (see TdokuRateFeatures), without searching. This takes about as long as
+ * solving an easy puzzle, instead of num_evals solves. The linear model is fitted against
+ * TdokuRate by the fit_rating_model tool, and src/rating_model.h records its error on the
+ * puzzles it was checked on.
+ * @param input
+ *       The puzzle as 81 characters, with '.' for empty cells.
+ * @return
+ *       The estimated rating, or 0 if the clues contradict each other, as TdokuRate gives for
+ *       puzzles without a solution.
+ */
+int TdokuRateEstimate(const char *input);
+
+/**
+ * Propagates the clues of a vanilla puzzle once and describes the resulting state by
+ * TDOKU_NUM_RATE_FEATURES features: a constant 1, the number of clues, the number of unsolved
+ * cells, their total number of candidates, the number of them with two candidates, the number
+ * of bands and stacks not yet fixed, their total number of excess value configurations (beyond
+ * the one per value of a fixed band) and its log(1 + x), the fewest excess configurations of a
+ * band or stack not yet fixed, the number of configurations of the value the solver would
+ * branch on first, and 1 if propagation solved the puzzle.
+ * @param input
+ *       The puzzle as 81 characters, with '.' for empty cells.
+ * @param features
+ *       Array of TDOKU_NUM_RATE_FEATURES elements to receive the features.
+ * @return
+ *       The number of features written, or 0 if the clues contradict each other.
+ */
+size_t TdokuRateFeatures(const char *input, float *features);
+
+/**
+ * Rates a batch of puzzles as TdokuRateSeeded would rate each of them, spreading the chunks of
+ * evaluations of all the puzzles over threads.
+ * @param puzzles
+ *       The first puzzle of the batch. Puzzle i starts at puzzles + i * stride.
+ * @param count
+ *       The number of puzzles in the batch.
+ * @param stride
+ *       The distance in bytes between the starts of consecutive puzzles, at least 81 (or 729
+ *       for pencilmark), e.g. 82 for newline separated vanilla puzzles.
+ * @param num_threads
+ *       The number of threads to use, or 0 for one per hardware thread.
+ * @param ratings
+ *       Array of count elements to receive the ratings.
+ */
+void TdokuRateBatch(const char *puzzles, size_t count, size_t stride, bool pencilmark,
+                    int solver, int num_evals, uint64_t random_seed, int num_threads,
+                    int *ratings);
+
 
 /**
  * Solves a Sudoku or Pencilmark Sudoku puzzle.
@@ -151,11 +472,18 @@ int TdokuRate(const char *input, bool pencilemark, int solver, int num_evals);
  * @param limit
  *       The maximum number of solutions to find before returning.
  * @param configuration
- *       Solver-specific configuration. Unused for tdoku.
+ *       Solver-specific configuration. For tdoku, 0 returns a solution only for a limit of 1,
+ *       1 returns the limit-th solution found, and 2 returns the first solution found while
+ *       still counting solutions up to the limit (e.g., a solution and 0, 1, 2+ from a
+ *       single search with a limit of 2). 3 is like 1, but searches in an order that finds
+ *       the solutions in exactly the reverse of the order of the others, so of a puzzle with
+ *       n solutions it returns the (n + 1 - limit)-th one in the usual order. Any other
+ *       nonzero configuration is the same as 1, which every nonzero configuration was before
+ *       2 and 3 were given their own meanings.
  * @param solution
- *       Pointer to an 81 character array to receive the solution. Tdoku will only return
- *       a solution if it was given a limit of 1. Otherwise it's assumed we're just interested
- *       in solution counts (e.g., 0, 1, 2+).
+ *       Pointer to an 81 character array to receive the solution. With configuration 0 Tdoku
+ *       will only return a solution if it was given a limit of 1. Otherwise it's assumed we're
+ *       just interested in solution counts (e.g., 0, 1, 2+).
  * @param num_guesses
  *       Out parameter to receive the number of guesses performed during search.
  * @return
@@ -167,6 +495,67 @@ size_t TdokuSolverDpllTriadSimd(const char *input,
                                 char *solution,
                                 size_t *num_guesses);
 
+/**
+ * Solves a batch of Sudoku or Pencilmark Sudoku puzzles stored in one contiguous buffer
+ * with the SIMD solver, reusing a single solver for the whole batch. The clues of vanilla
+ * puzzles are propagated for several puzzles at once (two per vector on AVX-512), which
+ * solves most puzzles outright, and only the rest are searched. Solution counts are the
+ * same as when the puzzles are solved individually. The rest of the search starts from the
+ * propagated puzzle, which doesn't always match where TdokuSolverDpllTriadSimd's own
+ * propagation would leave it. A few puzzles may therefore report a different guess count
+ * and, if they have more than one solution, a different first solution.
+ * @param puzzles
+ *       The first puzzle of the batch. Puzzle i starts at puzzles + i * stride. Every puzzle
+ *       in a batch must be of the same kind. The batch is treated as pencilmark only if
+ *       stride >= 729 and puzzles[81] >= '.', which is checked once for the whole batch.
+ * @param count
+ *       The number of puzzles in the batch.
+ * @param stride
+ *       The distance in bytes between the starts of consecutive puzzles, at least 81 (or 729
+ *       for pencilmark), e.g. 82 for newline separated vanilla puzzles.
+ * @param limit
+ *       The maximum number of solutions to find for each puzzle.
+ * @param solutions
+ *       Optional (may be NULL) array of count * 81 characters to receive solutions. Each
+ *       puzzle with at least one solution gets the first solution found, as with configuration
+ *       2 of TdokuSolverDpllTriadSimd. Entries for puzzles without a solution are set to '.'.
+ * @param counts
+ *       Optional (may be NULL) array of count elements to receive solution counts.
+ * @param guesses
+ *       Optional (may be NULL) array of count elements to receive guess counts.
+ * @return
+ *       The number of puzzles with at least one solution.
+ */
+size_t TdokuSolveBatch(const char *puzzles, size_t count, size_t stride, size_t limit,
+                       char *solutions, uint32_t *counts, uint32_t *guesses);
+
+/**
+ * Same as TdokuSolveBatch, but spreads the batch across worker threads. Each worker starts
+ * with an even share of the batch and steals from the others once its share is done, so a few
+ * hard puzzles don't leave the other workers idle. Results are stored at the input positions
+ * of their puzzles regardless of which worker solved them.
+ * @param num_threads
+ *       The number of worker threads to use, or 0 for one per hardware thread.
+ * @param wall_seconds
+ *       Optional (may be NULL) out parameter to receive the wall clock time taken by the batch.
+ * @return
+ *       The number of puzzles with at least one solution.
+ */
+size_t TdokuSolveBatchParallel(const char *puzzles, size_t count, size_t stride, size_t limit,
+                               int num_threads, char *solutions, uint32_t *counts,
+                               uint32_t *guesses, double *wall_seconds);
+
+/**
+ * Reports the instruction set used by TdokuSolverDpllTriadSimd and the functions built on it.
+ * A library built with the DISPATCH option contains the solver compiled for each of the
+ * levels below and picks the best one the CPU supports when loaded. Setting the TDOKU_SIMD
+ * environment variable to one of the names picks that level instead, if it's lower than the
+ * best supported one; other values are ignored.
+ * @return
+ *       One of "sse2", "sse4.1", "avx2" or "avx512".
+ */
+const char *TdokuSimdLevel(void);
+
 /**
  * Solves a Sudoku or Pencilmark Sudoku puzzle.
  * This function is for advanced use, TdokuSolve is recommended for basic use. 
@@ -210,6 +599,251 @@ size_t TdokuSolverDpllTriadScc(const char *input, size_t limit, uint32_t configu
 size_t TdokuSolverBasic(const char *input, size_t limit, uint32_t configuration,
                         char *solution, size_t *num_guesses);
 
+/**
+ * Creates a context for the TdokuContext* variants of the functions above.
+ * @param random_seed
+ *       A random seed for the context's random number generator, 0 is ignored.
+ * @return
+ *       The new context, to be released with TdokuContextDestroy, or NULL on failure.
+ */
+TdokuContext *TdokuContextCreate(uint64_t random_seed);
+
+/**
+ * Destroys a context created by TdokuContextCreate. Passing NULL is a no-op.
+ */
+void TdokuContextDestroy(TdokuContext *context);
+
+/**
+ * Same as TdokuSolverDpllTriadSimd, using the solvers owned by the context.
+ */
+size_t TdokuContextSolverDpllTriadSimd(TdokuContext *context, const char *input, size_t limit,
+                                       uint32_t configuration,
+                                       char *solution, size_t *num_guesses);
+
+/**
+ * Same as TdokuSolveImpl, using the context's SIMD solver when solver is 0.
+ */
+size_t TdokuContextSolveImpl(TdokuContext *context, const char *input, size_t limit, int solver,
+                             char *solution, size_t *num_guesses);
+
+/**
+ * Same as TdokuSolve, using the solvers owned by the context.
+ */
+size_t TdokuContextSolve(TdokuContext *context, const char* input, bool pencilmark,
+                         char* solution);
+
+/**
+ * Same as TdokuEnumerate, using the solver owned by the context.
+ */
+size_t TdokuContextEnumerate(TdokuContext *context, const char *input, size_t limit,
+                             void (*callback)(const char *, void *), void *callback_arg);
+
+/**
+ * Same as TdokuConstrain, using the context's solver and random number generator.
+ */
+bool TdokuContextConstrain(TdokuContext *context, bool pencilmark, char *input);
+
+/**
+ * Same as TdokuMinimize, using the context's solver and random number generator.
+ */
+bool TdokuContextMinimize(TdokuContext *context, bool pencilmark, bool monotonic, char *input);
+
+/**
+ * Same as TdokuRate, permuting the puzzle with the context's random number generator and
+ * solving with the context's SIMD solver when solver is 0.
+ */
+int TdokuContextRate(TdokuContext *context, const char *input, bool pencilmark, int solver,
+                     int num_evals);
+
+/**
+ * Same as TdokuGenerate, using the context's solvers and random number generator. The
+ * context's seed takes the place of random_seed, so puzzles from a seeded context are
+ * reproducible.
+ */
+size_t TdokuContextGenerate(TdokuContext *context, size_t num, bool pencilmark, char* buffer,
+                            char separator);
+
+/**
+ * Same as TdokuConstrainMasked, using the context's solver and random number generator.
+ */
+bool TdokuContextConstrainMasked(TdokuContext *context, const char *mask, int symmetry,
+                                 char *input);
+
+/**
+ * Same as TdokuMinimizeMasked, using the context's solver and random number generator.
+ */
+bool TdokuContextMinimizeMasked(TdokuContext *context, const char *mask, int symmetry,
+                                bool monotonic, char *input);
+
+/**
+ * Same as TdokuGenerateMasked, using the context's solvers and random number generator.
+ */
+size_t TdokuContextGenerateMasked(TdokuContext *context, size_t num, const char *mask,
+                                  int symmetry, char* buffer, char separator,
+                                  double *acceptance_rate);
+
+/**
+ * Same as TdokuGenerateStream, using the context's solvers and random number generator.
+ */
+size_t TdokuContextGenerateStream(TdokuContext *context, bool pencilmark, size_t max_puzzles,
+                                  uint64_t max_attempts, double max_seconds,
+                                  void (*callback)(const char *, void *), void *callback_arg);
+
+/**
+ * Same as TdokuGenerateScored, using the context's solvers and random number generator.
+ */
+size_t TdokuContextGenerateScored(TdokuContext *context, size_t num,
+                                  const struct GenerateOptions9x9 *options,
+                                  struct GenerateOut9x9 *output);
+
+/**
+ * Creates a generator that keeps its pool of patterns between calls. Every TdokuGenerate call
+ * starts from a pool of empty grids, so its first puzzles come from a cold pool; a generator
+ * pays this warm-up once, and its pool can be saved with TdokuGeneratorSerialize and restored
+ * with TdokuGeneratorDeserialize.
+ * @param pencilmark
+ *       A boolean indicating whether to generate pencilmark sudoku (vs. vanilla ones)
+ * @param pool_size
+ *       The number of patterns in the pool, or 0 for the default of 64 used by TdokuGenerate.
+ * @param random_seed
+ *       A random seed for generator, 0 is ignored.
+ * @return
+ *       The new generator, to be released with TdokuGeneratorDestroy, or NULL on failure.
+ */
+TdokuGenerator *TdokuGeneratorCreate(bool pencilmark, size_t pool_size, uint64_t random_seed);
+
+/**
+ * Destroys a generator created by TdokuGeneratorCreate. Passing NULL is a no-op.
+ */
+void TdokuGeneratorDestroy(TdokuGenerator *generator);
+
+/**
+ * Same as TdokuGenerate, drawing on and evolving the generator's pool.
+ */
+size_t TdokuGeneratorGenerate(TdokuGenerator *generator, size_t num, char* buffer,
+                              char separator);
+
+/**
+ * Same as TdokuGenerateStream, drawing on and evolving the generator's pool.
+ */
+size_t TdokuGeneratorGenerateStream(TdokuGenerator *generator, size_t max_puzzles,
+                                    uint64_t max_attempts, double max_seconds,
+                                    void (*callback)(const char *, void *), void *callback_arg);
+
+/**
+ * Same as TdokuGenerateScored, drawing on and evolving the generator's pool. Returns 0 for a
+ * pencilmark generator.
+ */
+size_t TdokuGeneratorGenerateScored(TdokuGenerator *generator, size_t num,
+                                    const struct GenerateOptions9x9 *options,
+                                    struct GenerateOut9x9 *output);
+
+/**
+ * Serializes the generator's pool as text.
+ * @param buffer
+ *       The buffer to receive the pool, or NULL to only get its size. Nothing is written if the
+ *       buffer is too small. The text is not null terminated.
+ * @param buffer_size
+ *       The size of the buffer.
+ * @return
+ *       The size of the serialized pool.
+ */
+size_t TdokuGeneratorSerialize(const TdokuGenerator *generator, char *buffer, size_t buffer_size);
+
+/**
+ * Replaces the generator's pool, including its size, with one from TdokuGeneratorSerialize.
+ * @return
+ *       A boolean indicating success. Fails, leaving the pool unchanged, if the buffer doesn't
+ *       hold a pool of the generator's kind of puzzle.
+ */
+bool TdokuGeneratorDeserialize(TdokuGenerator *generator, const char *buffer,
+                               size_t buffer_size);
+
+/**
+ * Makes the generator reject puzzles equivalent to one it generated before, i.e., with the same
+ * canonical form as given by TdokuCanonicalize (pencilmark puzzles are compared as they are).
+ * Seen puzzles are tracked with a bloom filter of fixed size that lives on across calls, so a
+ * small share of new puzzles is also rejected, growing as the filter fills up: about 1% with 10
+ * bits per puzzle seen. A rejected puzzle counts as a failed attempt and isn't added to the
+ * pool. Setting a filter discards any previous one.
+ * @param num_bytes
+ *       The size of the filter, or 0 to stop deduplicating.
+ */
+void TdokuGeneratorSetDedup(TdokuGenerator *generator, size_t num_bytes);
+
+/**
+ * @return
+ *       The number of puzzles the generator rejected as duplicates since the filter was set.
+ */
+uint64_t TdokuGeneratorNumDuplicates(const TdokuGenerator *generator);
+
+/**
+ * Maps a vanilla puzzle or grid to its canonical form, the minimal lexicographic representative
+ * of its equivalence class under transposition, permutations of bands, stacks, rows within a
+ * band, and columns within a stack, and relabeling of digits. Two puzzles are equivalent iff
+ * their canonical forms are equal.
+ * @param puzzle
+ *       The puzzle as 81 characters, where any character other than '1'-'9' is an empty cell.
+ * @param canonical
+ *       The buffer to receive the canonical form as 81 characters, with '.' for empty cells.
+ * @param transform
+ *       NULL, or a buffer of 28 bytes to receive a transform mapping the puzzle to its canonical
+ *       form, as accepted by TdokuTransform: whether the puzzle is transposed, the source row of
+ *       each output row, the source column of each output column, and the output digit of each
+ *       input digit 1-9.
+ */
+void TdokuCanonicalize(const char *puzzle, char *canonical, uint8_t *transform);
+
+/**
+ * Applies a transform from TdokuCanonicalize to a puzzle or solution, or maps back through its
+ * inverse, e.g., to recover the solution of a puzzle from the solution of its canonical form.
+ * @param puzzle
+ *       The puzzle as 81 characters, where any character other than '1'-'9' is an empty cell.
+ * @param transform
+ *       The 28 byte transform.
+ * @param inverse
+ *       A boolean indicating whether to apply the inverse transform.
+ * @param output
+ *       The buffer to receive the transformed puzzle as 81 characters, with '.' for empty cells.
+ */
+void TdokuTransform(const char *puzzle, const uint8_t *transform, bool inverse, char *output);
+
+/**
+ * Creates a cache of results for TdokuCacheSolve and TdokuCacheRate. Results are keyed by the
+ * canonical form of the puzzle, so a puzzle hits if it or any puzzle equivalent to it was seen
+ * before, and the least recently used result is evicted once the cache is full.
+ * @param capacity
+ *       The maximum number of results held.
+ * @return
+ *       The new cache, to be released with TdokuCacheDestroy.
+ */
+TdokuCache *TdokuCacheCreate(size_t capacity);
+
+void TdokuCacheDestroy(TdokuCache *cache);
+
+/**
+ * Same as TdokuSolve, returning the cached count and solution when the cache has them. The
+ * solution is mapped back from the canonical form, so for a puzzle with more than one solution
+ * it may differ from the one TdokuSolve would find. Pencilmark puzzles bypass the cache.
+ */
+size_t TdokuCacheSolve(TdokuCache *cache, const char* input, bool pencilmark, char* solution);
+
+/**
+ * Same as TdokuRate, returning the cached rating for the same solver and num_evals when the
+ * cache has one. Pencilmark puzzles bypass the cache.
+ */
+int TdokuCacheRate(TdokuCache *cache, const char *input, bool pencilmark, int solver,
+                   int num_evals);
+
+/**
+ * Reports the number of lookups that hit and missed the cache since it was created.
+ * @param hits
+ *       Out parameter to receive the number of hits, may be NULL.
+ * @param misses
+ *       Out parameter to receive the number of misses, may be NULL.
+ */
+void TdokuCacheStats(TdokuCache *cache, uint64_t *hits, uint64_t *misses);
+
 #ifdef __cplusplus
 }
 #endif
@@ -49,6 +49,9 @@ extern "C" {
     SolverFn TdokuSolverBasic;
     SolverFn TdokuSolverDpllTriadScc;
     SolverFn TdokuSolverDpllTriadSimd;
+    // the size of the search state tdoku copies for each guess, which depends on the state
+    // layout chosen at compile time (see the COMPACT_STATE build option).
+    size_t TdokuStateBytesCopiedPerGuess(void);
 
     SolverFn OtherSolverGss;
     SolverFn OtherSolverZ3;
@@ -3,6 +3,8 @@
 
 #include <cstdint>
 
+namespace {
+
 inline int NumBitsSet(uint32_t x) {
     return __builtin_popcount(x);
 }
@@ -43,4 +45,6 @@ inline int HighOrderBitIndex64(uint64_t nonzero_x) {
     return sizeof(uint64_t) * 8 - __builtin_clzll(nonzero_x) - 1;
 }
 
+} // namespace
+
 #endif //TDOKU_BIT_TWIDDLING_H
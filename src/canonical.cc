@@ -0,0 +1,547 @@
+#include "../include/tdoku.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#ifdef __SSE2__
+#include <immintrin.h>
+#endif
+
+// The canonical form of a puzzle is its minimal lexicographic representative (minlex) under the
+// group generated by transposition, permuting bands, rows within a band, stacks and columns
+// within a stack, and relabeling digits. Empty cells sort before digits, and relabeling is
+// always best done by numbering digits in their order of first appearance, so the search is
+// over the 2 * 6^8 arrangements of rows and columns, which we prune heavily.
+//
+// A full grid takes a separate path. Every row of a grid is a permutation of the top row, so
+// once the top row is labeled 1-9 the second row reads as a permutation of column positions,
+// conjugated by the column arrangement. We find the arrangements minimizing this conjugate
+// position by position, placing the column a value refers to as early as it can go, which
+// decides most of the arrangement while reading the second row. Puzzles with empty cells are
+// searched row by row, keeping tied columns and stacks together as ordered partitions that
+// later rows refine, and branching only where the order of tied cells decides which digits
+// get which labels.
+
+namespace {
+
+// rows and label tables are padded to 16 bytes so they can be mapped with byte shuffles.
+struct alignas(16) Row {
+    uint8_t cells[16];
+};
+
+constexpr uint8_t kInfinity = 0xff;
+
+// out[j] = labels[row[cols[j]]], for j in range(9).
+inline void MapRow(const Row &row, const Row &cols, const Row &labels, Row &out) {
+#ifdef __SSSE3__
+    __m128i cells = _mm_shuffle_epi8(_mm_load_si128((const __m128i *) row.cells),
+                                     _mm_load_si128((const __m128i *) cols.cells));
+    _mm_store_si128((__m128i *) out.cells,
+                    _mm_shuffle_epi8(_mm_load_si128((const __m128i *) labels.cells), cells));
+#else
+    for (int j = 0; j < 9; j++) out.cells[j] = labels.cells[row.cells[cols.cells[j]]];
+#endif
+}
+
+// out[j] = labels[row[j]], for j in range(9).
+inline void LabelRow(const Row &row, const Row &labels, Row &out) {
+#ifdef __SSSE3__
+    _mm_store_si128((__m128i *) out.cells,
+                    _mm_shuffle_epi8(_mm_load_si128((const __m128i *) labels.cells),
+                                     _mm_load_si128((const __m128i *) row.cells)));
+#else
+    for (int j = 0; j < 9; j++) out.cells[j] = labels.cells[row.cells[j]];
+#endif
+}
+
+// lexicographically compares the first 9 cells of two rows.
+inline int CompareRows(const uint8_t *a, const uint8_t *b) {
+#ifdef __SSE2__
+    uint32_t differ = ~(uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(
+            _mm_loadu_si128((const __m128i *) a), _mm_loadu_si128((const __m128i *) b))) & 0x1ffu;
+    if (!differ) return 0;
+    int i = __builtin_ctz(differ);
+    return a[i] < b[i] ? -1 : 1;
+#else
+    return memcmp(a, b, 9);
+#endif
+}
+
+struct Transform {
+    uint8_t transposed;
+    uint8_t rows[9];    // the source row of each output row
+    uint8_t cols[9];    // the source column of each output column
+    uint8_t labels[10]; // the output digit of each input digit, and 0 for empty cells
+
+    void Store(uint8_t *transform) const {
+        transform[0] = transposed;
+        memcpy(transform + 1, rows, 9);
+        memcpy(transform + 10, cols, 9);
+        memcpy(transform + 19, labels + 1, 9);
+    }
+
+    void Load(const uint8_t *transform) {
+        transposed = transform[0];
+        memcpy(rows, transform + 1, 9);
+        memcpy(cols, transform + 10, 9);
+        labels[0] = 0;
+        memcpy(labels + 1, transform + 19, 9);
+    }
+
+    // numbers the digits without a label after those with one, so labels are a permutation.
+    void CompleteLabels(uint8_t next_label) {
+        for (int d = 1; d <= 9; d++) {
+            if (!labels[d]) labels[d] = next_label++;
+        }
+    }
+};
+
+class Canonicalizer {
+public:
+    explicit Canonicalizer(const char *puzzle) {
+        memset(rows_, 0, sizeof(rows_));
+        for (int r = 0; r < 9; r++) {
+            for (int c = 0; c < 9; c++) {
+                char ch = puzzle[r * 9 + c];
+                uint8_t digit = ch >= '1' && ch <= '9' ? (uint8_t) (ch - '0') : 0;
+                rows_[0][r].cells[c] = digit;
+                rows_[1][c].cells[r] = digit;
+            }
+        }
+        memset(best_, kInfinity, sizeof(best_));
+    }
+
+    void Canonicalize(char *out, uint8_t *transform) {
+        if (IsGrid()) {
+            CanonicalizeGrid();
+        } else {
+            for (int transposed = 0; transposed < 2; transposed++) {
+                PuzzleState state;
+                state.transposed = (uint8_t) transposed;
+                Search(state, 0);
+            }
+        }
+        for (int i = 0; i < 81; i++) out[i] = best_[i] ? (char) ('0' + best_[i]) : '.';
+        if (transform) best_transform_.Store(transform);
+    }
+
+private:
+    Row rows_[2][9];  // the rows of the puzzle and of its transpose
+    uint8_t best_[81 + 16];  // the least output found, padded for unaligned row loads
+    Transform best_transform_{};
+    bool have_transform_ = false;
+
+    // lowers the best output at a row, which invalidates everything after it.
+    void LowerBest(int row, const uint8_t *cells) {
+        memcpy(best_ + row * 9, cells, 9);
+        memset(best_ + (row + 1) * 9, kInfinity, 81 - (row + 1) * 9);
+        have_transform_ = false;
+    }
+
+    // whether every row and every column holds each digit once.
+    bool IsGrid() const {
+        for (const auto &orientation : rows_) {
+            for (const Row &row : orientation) {
+                uint32_t seen = 0;
+                for (int c = 0; c < 9; c++) seen |= 1u << row.cells[c];
+                if (seen != 0x3feu) return false;
+            }
+        }
+        return true;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////////////
+    // grids
+
+    // a partial column arrangement: the source column at each output position and the inverse,
+    // and the source stack at each output block and the inverse, with -1 where undecided.
+    struct Columns {
+        int8_t col_at[9];
+        int8_t pos_of[9];
+        int8_t stack_at[3];
+        int8_t block_of[3];
+
+        void Place(int col, int pos) {
+            col_at[pos] = (int8_t) col;
+            pos_of[col] = (int8_t) pos;
+            stack_at[pos / 3] = (int8_t) (col / 3);
+            block_of[col / 3] = (int8_t) (pos / 3);
+        }
+
+        bool CanPlace(int col, int pos) const {
+            if (col_at[pos] >= 0) return false;
+            int block = pos / 3, stack = col / 3;
+            return stack_at[block] == stack || (stack_at[block] < 0 && block_of[stack] < 0);
+        }
+    };
+
+    struct GridCandidate {
+        uint8_t transposed;
+        uint8_t top_rows[2];
+        Columns columns;
+    };
+
+    uint8_t best_second_row_[9]{};
+    std::vector<GridCandidate> grid_candidates_;
+
+    void CanonicalizeGrid() {
+        // the top row is always 123456789, so the first choice to make is the second row.
+        memset(best_second_row_, kInfinity, 9);
+        for (int transposed = 0; transposed < 2; transposed++) {
+            for (int top = 0; top < 9; top++) {
+                int col_of_digit[10];
+                for (int c = 0; c < 9; c++) col_of_digit[rows_[transposed][top].cells[c]] = c;
+                for (int second = top / 3 * 3; second < top / 3 * 3 + 3; second++) {
+                    if (second == top) continue;
+                    // the second row as a permutation of the top row's columns.
+                    int8_t image[9];
+                    for (int c = 0; c < 9; c++) {
+                        image[c] = (int8_t) col_of_digit[rows_[transposed][second].cells[c]];
+                    }
+                    GridCandidate candidate{(uint8_t) transposed, {(uint8_t) top, (uint8_t) second},
+                                            {}};
+                    memset(&candidate.columns, -1, sizeof(Columns));
+                    SearchSecondRow(candidate, image, 0);
+                }
+            }
+        }
+        for (const GridCandidate &candidate : grid_candidates_) {
+            CompleteGrid(candidate);
+        }
+    }
+
+    // finds the column arrangements minimizing the second row, position by position. a column
+    // at position j refers to the column holding its digit in the top row, and reads as that
+    // column's position. so if that column isn't placed yet, it's best placed at the earliest
+    // position it can go, and doing so is forced for this choice of column at j.
+    void SearchSecondRow(GridCandidate &candidate, const int8_t *image, int j) {
+        Columns saved = candidate.columns;
+        Columns &columns = candidate.columns;
+        // positions already taken by a referred column need no choice.
+        for (; j < 9 && columns.col_at[j] >= 0; j++) {
+            uint8_t value = PlaceReferred(columns, image[columns.col_at[j]], j);
+            if (value > best_second_row_[j]) {
+                columns = saved;
+                return;
+            }
+            if (value < best_second_row_[j]) LowerSecondRow(j, value);
+        }
+        if (j == 9) {
+            grid_candidates_.push_back(candidate);
+            columns = saved;
+            return;
+        }
+        Columns options[9];
+        uint8_t values[9];
+        int num_options = 0;
+        uint8_t min_value = kInfinity;
+        for (int col = 0; col < 9; col++) {
+            if (columns.pos_of[col] >= 0 || !columns.CanPlace(col, j)) continue;
+            Columns &option = options[num_options];
+            option = columns;
+            option.Place(col, j);
+            values[num_options] = PlaceReferred(option, image[col], j);
+            min_value = std::min(min_value, values[num_options++]);
+        }
+        if (min_value <= best_second_row_[j]) {
+            if (min_value < best_second_row_[j]) LowerSecondRow(j, min_value);
+            for (int i = 0; i < num_options; i++) {
+                if (values[i] != min_value) continue;
+                columns = options[i];
+                SearchSecondRow(candidate, image, j + 1);
+            }
+        }
+        columns = saved;
+    }
+
+    // places the column referred to from position j as early as it can go, and returns the
+    // value this gives position j.
+    static uint8_t PlaceReferred(Columns &columns, int referred, int j) {
+        if (columns.pos_of[referred] < 0) {
+            for (int pos = j + 1; pos < 9; pos++) {
+                if (columns.CanPlace(referred, pos)) {
+                    columns.Place(referred, pos);
+                    break;
+                }
+            }
+        }
+        return (uint8_t) (columns.pos_of[referred] + 1);
+    }
+
+    void LowerSecondRow(int j, uint8_t value) {
+        best_second_row_[j] = value;
+        memset(best_second_row_ + j + 1, kInfinity, 8 - j);
+        grid_candidates_.clear();
+    }
+
+    // given the top two rows and the columns, the rest of the top band is fixed and the other
+    // bands are best ordered by sorting their rows.
+    void CompleteGrid(const GridCandidate &candidate) {
+        const Row *rows = rows_[candidate.transposed];
+        Transform transform{};
+        transform.transposed = candidate.transposed;
+        Row cols{}, labels{};
+        for (int j = 0; j < 16; j++) cols.cells[j] = (uint8_t) (j < 9 ? candidate.columns.col_at[j] : j);
+        for (int j = 0; j < 9; j++) {
+            transform.cols[j] = cols.cells[j];
+            labels.cells[rows[candidate.top_rows[0]].cells[cols.cells[j]]] = (uint8_t) (j + 1);
+        }
+        memcpy(transform.labels, labels.cells, 10);
+
+        Row mapped[9];
+        for (int r = 0; r < 9; r++) MapRow(rows[r], cols, labels, mapped[r]);
+
+        int top_band = candidate.top_rows[0] / 3;
+        int order[9];
+        order[0] = candidate.top_rows[0];
+        order[1] = candidate.top_rows[1];
+        order[2] = top_band * 3 + 3 - candidate.top_rows[0] % 3 - candidate.top_rows[1] % 3;
+        auto row_less = [&](int a, int b) { return CompareRows(mapped[a].cells, mapped[b].cells) < 0; };
+        int band_rows[2][3];
+        for (int b = 0, i = 0; b < 3; b++) {
+            if (b == top_band) continue;
+            for (int k = 0; k < 3; k++) band_rows[i][k] = b * 3 + k;
+            std::sort(band_rows[i], band_rows[i] + 3, row_less);
+            i++;
+        }
+        int first = row_less(band_rows[1][0], band_rows[0][0]) ? 1 : 0;
+        for (int k = 0; k < 3; k++) {
+            order[3 + k] = band_rows[first][k];
+            order[6 + k] = band_rows[1 - first][k];
+        }
+
+        for (int i = 0; i < 9; i++) {
+            int cmp = CompareRows(mapped[order[i]].cells, best_ + i * 9);
+            if (cmp > 0) return;
+            if (cmp < 0) {
+                for (int k = i; k < 9; k++) memcpy(best_ + k * 9, mapped[order[k]].cells, 9);
+                have_transform_ = false;
+                break;
+            }
+        }
+        if (!have_transform_) {
+            for (int i = 0; i < 9; i++) transform.rows[i] = (uint8_t) order[i];
+            best_transform_ = transform;
+            have_transform_ = true;
+        }
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////////////
+    // puzzles
+
+    // the state of a search over row arrangements. stacks (in block order) and the columns
+    // of each stack (in position order) are kept as ordered partitions: tied[i] marks that
+    // the item at i is interchangeable with the item at i + 1 given the rows chosen so far.
+    // digits without a label map to next_label, a lower bound on the label they will get.
+    struct PuzzleState {
+        uint8_t transposed = 0;
+        uint8_t rows[9]{};
+        uint16_t used_rows = 0;
+        uint16_t labeled = 0;
+        uint8_t stacks[3]{0, 1, 2};
+        uint8_t stacks_tied[3]{1, 1, 0};
+        uint8_t cols[3][3]{{0, 1, 2}, {0, 1, 2}, {0, 1, 2}};
+        uint8_t cols_tied[3][3]{{1, 1, 0}, {1, 1, 0}, {1, 1, 0}};
+        Row labels{{0, 1, 1, 1, 1, 1, 1, 1, 1, 1}};
+        uint8_t next_label = 1;
+
+        bool IsNew(uint8_t digit) const {
+            return digit && !(labeled & (1u << digit));
+        }
+    };
+
+    // orders the tied runs of n items by key, keeping ties between equal keys.
+    template<typename KeyLess, typename KeyEqual>
+    static void Refine(uint8_t *items, uint8_t *tied, int n, KeyLess less, KeyEqual equal) {
+        for (int begin = 0; begin < n;) {
+            int end = begin;
+            while (tied[end]) end++;
+            if (end > begin) {
+                std::stable_sort(items + begin, items + end + 1, less);
+                for (int i = begin; i < end; i++) tied[i] = equal(items[i], items[i + 1]);
+            }
+            begin = end + 1;
+        }
+    }
+
+    static void ArrangedRow(const PuzzleState &state, const Row &values, uint8_t *out) {
+        for (int i = 0; i < 3; i++) {
+            int s = state.stacks[i];
+            for (int k = 0; k < 3; k++) out[i * 3 + k] = values.cells[s * 3 + state.cols[s][k]];
+        }
+    }
+
+    // arranges the columns to minimize the given row, leaving ties, and returns a lower bound
+    // on the row. it's exact but for the labels of new digits.
+    static void ArrangeForRow(PuzzleState &state, const Row &row, uint8_t *out) {
+        Row values;
+        LabelRow(row, state.labels, values);
+        const uint8_t *v = values.cells;
+        for (int s = 0; s < 3; s++) {
+            const uint8_t *stack_values = v + s * 3;
+            Refine(state.cols[s], state.cols_tied[s], 3,
+                   [&](uint8_t a, uint8_t b) { return stack_values[a] < stack_values[b]; },
+                   [&](uint8_t a, uint8_t b) { return stack_values[a] == stack_values[b]; });
+        }
+        uint8_t sequences[3][3];
+        for (int s = 0; s < 3; s++) {
+            for (int k = 0; k < 3; k++) sequences[s][k] = v[s * 3 + state.cols[s][k]];
+        }
+        Refine(state.stacks, state.stacks_tied, 3,
+               [&](uint8_t a, uint8_t b) { return memcmp(sequences[a], sequences[b], 3) < 0; },
+               [&](uint8_t a, uint8_t b) { return memcmp(sequences[a], sequences[b], 3) == 0; });
+        for (int i = 0; i < 3; i++) memcpy(out + i * 3, sequences[state.stacks[i]], 3);
+    }
+
+    // ties between cells holding new digits decide which digit gets which label, so they are
+    // broken in every possible way before labeling the digits and moving on to the next row.
+    void ResolveNewDigits(PuzzleState &state, const Row &row, int depth) {
+        const uint8_t *digits = row.cells;
+        // columns within a stack.
+        for (int s = 0; s < 3; s++) {
+            for (int i = 0; i < 2; i++) {
+                if (!state.cols_tied[s][i] || !state.IsNew(digits[s * 3 + state.cols[s][i]])) {
+                    continue;
+                }
+                int end = i;
+                while (state.cols_tied[s][end]) end++;
+                for (int k = i; k <= end; k++) {
+                    PuzzleState broken = state;
+                    std::rotate(broken.cols[s] + i, broken.cols[s] + k, broken.cols[s] + k + 1);
+                    broken.cols_tied[s][i] = 0;
+                    ResolveNewDigits(broken, row, depth);
+                }
+                return;
+            }
+        }
+        // stacks within a block.
+        for (int i = 0; i < 2; i++) {
+            if (!state.stacks_tied[i]) continue;
+            int s = state.stacks[i];
+            bool has_new = false;
+            for (int k = 0; k < 3; k++) has_new |= state.IsNew(digits[s * 3 + state.cols[s][k]]);
+            if (!has_new) continue;
+            int end = i;
+            while (state.stacks_tied[end]) end++;
+            for (int k = i; k <= end; k++) {
+                PuzzleState broken = state;
+                std::rotate(broken.stacks + i, broken.stacks + k, broken.stacks + k + 1);
+                broken.stacks_tied[i] = 0;
+                ResolveNewDigits(broken, row, depth);
+            }
+            return;
+        }
+        // label new digits in the order they appear, then check the row against the best.
+        uint8_t arranged[16];
+        ArrangedRow(state, row, arranged);
+        for (int j = 0; j < 9; j++) {
+            uint8_t digit = arranged[j];
+            if (state.IsNew(digit)) {
+                state.labels.cells[digit] = state.next_label++;
+                state.labeled |= (uint16_t) (1u << digit);
+            }
+        }
+        for (int d = 1; d <= 9; d++) {
+            if (state.IsNew((uint8_t) d)) state.labels.cells[d] = state.next_label;
+        }
+        Row values;
+        LabelRow(row, state.labels, values);
+        ArrangedRow(state, values, arranged);
+        int cmp = CompareRows(arranged, best_ + depth * 9);
+        if (cmp > 0) return;
+        if (cmp < 0) LowerBest(depth, arranged);
+        Search(state, depth + 1);
+    }
+
+    void Search(const PuzzleState &state, int depth) {
+        if (depth == 9) {
+            if (!have_transform_) {
+                Transform &transform = best_transform_;
+                transform.transposed = state.transposed;
+                memcpy(transform.rows, state.rows, 9);
+                for (int i = 0; i < 3; i++) {
+                    int s = state.stacks[i];
+                    for (int k = 0; k < 3; k++) {
+                        transform.cols[i * 3 + k] = (uint8_t) (s * 3 + state.cols[s][k]);
+                    }
+                }
+                transform.labels[0] = 0;
+                for (int d = 1; d <= 9; d++) {
+                    transform.labels[d] = state.IsNew((uint8_t) d) ? 0 : state.labels.cells[d];
+                }
+                transform.CompleteLabels(state.next_label);
+                have_transform_ = true;
+            }
+            return;
+        }
+
+        // rows that may come next: any row of an unused band at the start of a band, and
+        // otherwise the unused rows of the current band. rows with the same cells as an
+        // earlier row of their band lead to the same outputs, so we skip them.
+        const Row *rows = rows_[state.transposed];
+        int candidates[9];
+        int num_candidates = 0;
+        for (int r = 0; r < 9; r++) {
+            if (state.used_rows & (1u << r)) continue;
+            if (depth % 3 != 0 && r / 3 != state.rows[depth - 1] / 3) continue;
+            if (depth % 3 == 0 && (state.used_rows >> (r / 3 * 3)) & 7u) continue;
+            bool duplicate = false;
+            for (int i = 0; i < num_candidates && !duplicate; i++) {
+                duplicate = candidates[i] / 3 == r / 3 &&
+                            CompareRows(rows[candidates[i]].cells, rows[r].cells) == 0;
+            }
+            if (!duplicate) candidates[num_candidates++] = r;
+        }
+
+        PuzzleState next[9];
+        uint8_t bounds[9][16];
+        int order[9];
+        for (int i = 0; i < num_candidates; i++) {
+            next[i] = state;
+            ArrangeForRow(next[i], rows[candidates[i]], bounds[i]);
+            next[i].rows[depth] = (uint8_t) candidates[i];
+            next[i].used_rows |= (uint16_t) (1u << candidates[i]);
+            order[i] = i;
+        }
+        // explore the least rows first, so the bound tightens early.
+        std::sort(order, order + num_candidates,
+                  [&](int a, int b) { return CompareRows(bounds[a], bounds[b]) < 0; });
+        for (int i = 0; i < num_candidates; i++) {
+            int c = order[i];
+            if (CompareRows(bounds[c], best_ + depth * 9) > 0) break;
+            ResolveNewDigits(next[c], rows[candidates[c]], depth);
+        }
+    }
+};
+
+} // namespace
+
+extern "C"
+void TdokuCanonicalize(const char *input, char *output, uint8_t *transform) {
+    Canonicalizer canonicalizer(input);
+    canonicalizer.Canonicalize(output, transform);
+}
+
+extern "C"
+void TdokuTransform(const char *input, const uint8_t *transform, bool inverse, char *output) {
+    Transform t{};
+    t.Load(transform);
+    uint8_t inverse_labels[10]{};
+    for (int d = 1; d <= 9; d++) inverse_labels[t.labels[d]] = (uint8_t) d;
+    for (int i = 0; i < 9; i++) {
+        for (int j = 0; j < 9; j++) {
+            // the cell at output (i, j) comes from (rows[i], cols[j]) of the possibly transposed
+            // input.
+            int r = t.rows[i], c = t.cols[j];
+            int source = t.transposed ? c * 9 + r : r * 9 + c;
+            if (!inverse) {
+                char ch = input[source];
+                output[i * 9 + j] = ch >= '1' && ch <= '9' ? (char) ('0' + t.labels[ch - '0']) : '.';
+            } else {
+                char ch = input[i * 9 + j];
+                output[source] = ch >= '1' && ch <= '9' ? (char) ('0' + inverse_labels[ch - '0']) : '.';
+            }
+        }
+    }
+}
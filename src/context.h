@@ -0,0 +1,15 @@
+#ifndef TDOKU_CONTEXT_H
+#define TDOKU_CONTEXT_H
+
+#include "../include/tdoku.h"
+
+class Util;
+
+// library-internal access to the RNG owned by a context, so code outside the solver can draw
+// from the same seeded stream (e.g., for permuting puzzles while rating).
+#ifdef __cplusplus
+extern "C"
+#endif
+Util *TdokuContextUtil(TdokuContext *context);
+
+#endif //TDOKU_CONTEXT_H
@@ -0,0 +1,197 @@
+#include "tdoku.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// fits the linear model behind TdokuRateEstimate to ratings from TdokuRateBatch, and prints it
+// as the contents of src/rating_model.h along with its error on held out puzzles.
+
+namespace {
+
+constexpr int kNumFeatures = TDOKU_NUM_RATE_FEATURES;
+
+// reads newline separated vanilla puzzles, skipping comments and anything after the puzzle.
+vector<string> LoadPuzzles(const char *filename) {
+    vector<string> puzzles;
+    ifstream file(filename);
+    string line;
+    while (getline(file, line)) {
+        if (line.size() >= 81 && line[0] != '#') {
+            string puzzle = line.substr(0, 81);
+            for (char &c : puzzle) {
+                if (c < '1' || c > '9') c = '.';
+            }
+            puzzles.push_back(puzzle);
+        }
+    }
+    return puzzles;
+}
+
+// half of the puzzles from TdokuGenerate, which are mostly easy, and half from scored
+// generation favoring puzzles that take many guesses, so the fit covers hard puzzles too.
+vector<string> GeneratePuzzles(size_t num, uint64_t seed) {
+    vector<string> puzzles;
+    vector<char> buffer((num / 2 + 1) * 82);
+    size_t count = TdokuGenerate(num / 2, false, seed, buffer.data(), '\n');
+    for (size_t i = 0; i < count; i++) puzzles.emplace_back(&buffer[i * 82], 81);
+
+    GenerateOptions9x9 options;
+    TdokuGenerateOptionsDefault(&options);
+    options.clue_weight = 0.2;
+    options.guess_weight = 4.0;
+    vector<GenerateOut9x9> scored(num - num / 2);
+    count = TdokuGenerateScored(scored.size(), &options, seed + 1, scored.data());
+    for (size_t i = 0; i < count; i++) puzzles.emplace_back(scored[i].data, 81);
+    return puzzles;
+}
+
+// solves the normal equations of a least squares fit with a small ridge penalty by gaussian
+// elimination with partial pivoting.
+vector<double> FitLeastSquares(const vector<array<double, kNumFeatures>> &x,
+                               const vector<double> &y) {
+    double a[kNumFeatures][kNumFeatures + 1]{};
+    for (size_t n = 0; n < x.size(); n++) {
+        for (int i = 0; i < kNumFeatures; i++) {
+            for (int j = 0; j < kNumFeatures; j++) a[i][j] += x[n][i] * x[n][j];
+            a[i][kNumFeatures] += x[n][i] * y[n];
+        }
+    }
+    for (int i = 1; i < kNumFeatures; i++) a[i][i] += 1e-3 * (double) x.size();
+
+    for (int col = 0; col < kNumFeatures; col++) {
+        int pivot = col;
+        for (int row = col + 1; row < kNumFeatures; row++) {
+            if (fabs(a[row][col]) > fabs(a[pivot][col])) pivot = row;
+        }
+        for (int k = 0; k <= kNumFeatures; k++) swap(a[col][k], a[pivot][k]);
+        if (a[col][col] == 0.0) continue;
+        for (int row = 0; row < kNumFeatures; row++) {
+            if (row == col) continue;
+            double factor = a[row][col] / a[col][col];
+            for (int k = col; k <= kNumFeatures; k++) a[row][k] -= factor * a[col][k];
+        }
+    }
+    vector<double> weights(kNumFeatures);
+    for (int i = 0; i < kNumFeatures; i++) {
+        weights[i] = a[i][i] == 0.0 ? 0.0 : a[i][kNumFeatures] / a[i][i];
+    }
+    return weights;
+}
+
+void usage() {
+    cout << "usage: fit_rating_model [-n num_evals] [-s seed] [-g num_generated] [puzzle_file]"
+         << endl;
+    cout << "  fits the TdokuRateEstimate model to TdokuRate ratings of the puzzles in the file, "
+            "or of generated ones," << endl;
+    cout << "  and prints src/rating_model.h. every fifth puzzle is held out to measure the "
+            "error." << endl;
+    exit(1);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    int num_evals = 100;
+    uint64_t seed = 1;
+    size_t num_generated = 20000;
+    const char *filename = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+            num_evals = stoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-s") && i + 1 < argc) {
+            seed = stoull(argv[++i]);
+        } else if (!strcmp(argv[i], "-g") && i + 1 < argc) {
+            num_generated = stoull(argv[++i]);
+        } else if (argv[i][0] != '-' && !filename) {
+            filename = argv[i];
+        } else {
+            usage();
+        }
+    }
+
+    vector<string> puzzles = filename ? LoadPuzzles(filename) :
+                             GeneratePuzzles(num_generated, seed);
+    string dataset = filename ? string(filename) :
+                     to_string(puzzles.size()) + " generated puzzles (seed " + to_string(seed) +
+                     ")";
+
+    // ratings and features, leaving out puzzles whose clues contradict each other.
+    string joined;
+    for (const string &puzzle : puzzles) joined += puzzle;
+    vector<int> ratings(puzzles.size());
+    TdokuRateBatch(joined.data(), puzzles.size(), 81, false, 0, num_evals, seed, 0,
+                   ratings.data());
+    vector<array<double, kNumFeatures>> fit_x, test_x;
+    vector<double> fit_y, test_y;
+    vector<size_t> test_puzzles;
+    for (size_t i = 0; i < puzzles.size(); i++) {
+        float features[kNumFeatures];
+        if (!TdokuRateFeatures(puzzles[i].c_str(), features)) continue;
+        array<double, kNumFeatures> x{};
+        for (int k = 0; k < kNumFeatures; k++) x[k] = features[k];
+        if (i % 5 == 4) {
+            test_x.push_back(x);
+            test_y.push_back(ratings[i]);
+            test_puzzles.push_back(i);
+        } else {
+            fit_x.push_back(x);
+            fit_y.push_back(ratings[i]);
+        }
+    }
+    if (fit_x.empty() || test_x.empty()) {
+        cerr << "not enough puzzles" << endl;
+        return 1;
+    }
+    vector<double> weights = FitLeastSquares(fit_x, fit_y);
+
+    // the error of the model as TdokuRateEstimate applies it, i.e., clamped at 0.
+    double sum_abs = 0.0, sum_squares = 0.0, sum_y = 0.0, sum_yy = 0.0;
+    for (size_t n = 0; n < test_x.size(); n++) {
+        double estimate = 0.0;
+        for (int k = 0; k < kNumFeatures; k++) estimate += weights[k] * test_x[n][k];
+        double error = round(max(estimate, 0.0)) - test_y[n];
+        sum_abs += fabs(error);
+        sum_squares += error * error;
+        sum_y += test_y[n];
+        sum_yy += test_y[n] * test_y[n];
+    }
+    double num_test = (double) test_x.size();
+    double mean_abs = sum_abs / num_test;
+    double rmse = sqrt(sum_squares / num_test);
+    double variance = sum_yy / num_test - (sum_y / num_test) * (sum_y / num_test);
+    double r_squared = variance > 0 ? 1.0 - sum_squares / num_test / variance : 0.0;
+
+    // time the estimate itself.
+    auto start = chrono::steady_clock::now();
+    int checksum = 0;
+    for (size_t i : test_puzzles) checksum += TdokuRateEstimate(puzzles[i].c_str());
+    double micros = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count() /
+                    num_test;
+    cerr << "mean absolute error " << mean_abs << ", rms error " << rmse << ", r^2 " << r_squared
+         << ", current estimate " << micros << " us/puzzle (" << checksum << ")" << endl;
+
+    printf("#ifndef TDOKU_RATING_MODEL_H\n#define TDOKU_RATING_MODEL_H\n\n");
+    printf("// generated by fit_rating_model -n %d -s %llu: weights of the features from\n",
+           num_evals, (unsigned long long) seed);
+    printf("// TdokuRateFeatures in a linear estimate of TdokuRate with num_evals = %d, fitted to\n",
+           num_evals);
+    printf("// %s.\n", dataset.c_str());
+    printf("// on %zu held out puzzles: mean absolute error %.0f, rms error %.0f, r^2 %.2f.\n\n",
+           test_x.size(), mean_abs, rmse, r_squared);
+    printf("namespace {\n\nconstexpr float kRatingModel[TDOKU_NUM_RATE_FEATURES] = {\n");
+    for (int k = 0; k < kNumFeatures; k++) {
+        printf("        %.6gf%s\n", weights[k], k + 1 < kNumFeatures ? "," : "");
+    }
+    printf("};\n\n} // namespace\n\n#endif //TDOKU_RATING_MODEL_H\n");
+    return 0;
+}
@@ -1,8 +1,13 @@
 #include "../include/tdoku.h"
+#include "context.h"
 #include "klib/ketopt.h"
+#include "parallel.h"
+#include "rating.h"
+#include "symmetry.h"
 #include "util.h"
 
 #include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <cstdint>
 #include <cstdio>
@@ -11,6 +16,7 @@
 #include <fstream>
 #include <iostream>
 #include <limits>
+#include <memory>
 #include <random>
 #include <set>
 #include <tuple>
@@ -43,27 +49,90 @@ struct Options {
     uint64_t random_seed = 0; // 0 is ignored
     bool minimize = true;
     bool pencilmark = false;
+    // the window of accepted puzzles for scored generation, where 0 means no bound.
+    uint32_t min_clues = 0;
+    uint32_t max_clues = 0;
+    int min_rating = 0;
+    int max_rating = 0;
+    // for vanilla puzzles, the cells where clues are allowed ('.' disallows a cell) and the
+    // symmetry of clue groups, as taken by TdokuConstrainMasked. null allows every cell.
+    const char *mask = nullptr;
+    int symmetry = 0;
+    // the size of the filter rejecting puzzles equivalent to earlier ones, 0 for none.
+    size_t dedup_bytes = 0;
+};
+
+// a bloom filter over the canonical forms of generated puzzles, used to reject puzzles
+// equivalent to one generated before. it has a fixed size, so its false positive rate (and with
+// it the rate of puzzles rejected for no reason) grows with the number of puzzles seen: about 1%
+// at 10 bits per puzzle and 10% at 5.
+struct DedupFilter {
+    static constexpr int kNumHashes = 7;
+    vector<uint64_t> bits;
+    uint64_t num_rejected = 0;
+
+    explicit DedupFilter(size_t num_bytes) : bits(max(num_bytes / 8, (size_t) 1)) {}
+
+    static uint64_t Hash(const char *data, size_t size, uint64_t seed) {
+        uint64_t h = seed ^ (size * 0x9e3779b97f4a7c15ull);
+        for (size_t i = 0; i < size; i += 8) {
+            uint64_t word = 0;
+            memcpy(&word, data + i, min((size_t) 8, size - i));
+            h = (h ^ word) * 0xbf58476d1ce4e5b9ull;
+            h ^= h >> 31u;
+        }
+        h = (h ^ (h >> 27u)) * 0x94d049bb133111ebull;
+        return h ^ (h >> 31u);
+    }
+
+    // adds a puzzle, returning false if an equivalent one (or a false positive) was seen.
+    // vanilla puzzles are compared by canonical form, pencilmark puzzles as they are.
+    bool Insert(const char *puzzle, bool pencilmark) {
+        char canonical[81];
+        const char *key = puzzle;
+        size_t size = pencilmark ? 729 : 81;
+        if (!pencilmark) {
+            TdokuCanonicalize(puzzle, canonical, nullptr);
+            key = canonical;
+        }
+        uint64_t h1 = Hash(key, size, 0x243f6a8885a308d3ull);
+        uint64_t h2 = Hash(key, size, 0x13198a2e03707344ull) | 1u;
+        uint64_t num_bits = bits.size() * 64;
+        bool seen = true;
+        for (int i = 0; i < kNumHashes; i++) {
+            uint64_t bit = (h1 + i * h2) % num_bits;
+            uint64_t mask = 1ull << (bit & 63u);
+            seen &= (bits[bit >> 6u] & mask) != 0;
+            bits[bit >> 6u] |= mask;
+        }
+        if (seen) num_rejected++;
+        return !seen;
+    }
 };
 
 struct Generator {
     Options options_;
-    Util util_{};
-    char* pattern_list;
-    const size_t max_pattern = 64;
+    // solvers and RNG are borrowed from the context, which is seeded by the caller.
+    TdokuContext *context_;
+    Util &util_;
+    vector<char> pattern_list;
+    // losses of the patterns in the pool for scored generation, lower is better.
+    vector<double> pattern_loss;
+    size_t max_pattern = 64;
     size_t pattern_size = 81;
+    // rejects puzzles equivalent to earlier ones when set.
+    unique_ptr<DedupFilter> dedup;
 
-    explicit Generator(const Options &options) : options_(options) {
-        if(options.random_seed != 0){
-            util_.RandomSeed(options.random_seed);
-        }
+    Generator(const Options &options, TdokuContext *context, size_t pool_size = 64)
+            : options_(options), context_(context), util_(*TdokuContextUtil(context)),
+              max_pattern(pool_size) {
         if(options.pencilmark){
             pattern_size = 729;
         }
-        pattern_list = new char[max_pattern * pattern_size];
-    }
-
-    ~Generator(){
-        delete[] pattern_list;
+        pattern_list.resize(max_pattern * pattern_size);
+        if (options.dedup_bytes) {
+            dedup.reset(new DedupFilter(options.dedup_bytes));
+        }
     }
 
     const string kInitPencilmark =
@@ -84,87 +153,536 @@ struct Generator {
         const string &initial = options_.pencilmark ? kInitPencilmark : kInitVanilla;
 
         for (int i = 0; i < max_pattern; i++) {
-            memcpy(pattern_list + pattern_size * i, initial.c_str(), pattern_size);
+            memcpy(pattern_list.data() + pattern_size * i, initial.c_str(), pattern_size);
         }
+        pattern_loss.assign(max_pattern, numeric_limits<double>::infinity());
     }
 
     bool HasUniqueSolution(const char *puzzle) {
         char solution[81];
         size_t guesses = 0;
-        return TdokuSolverDpllTriadSimd(puzzle, 2, 0, solution, &guesses) == 1;
+        return TdokuContextSolverDpllTriadSimd(context_, puzzle, 2, 0, solution, &guesses) == 1;
     }
 
-    size_t Generate(char* output_puzzles, char separator) {
-        char puzzle[730];
+    // draws a pattern from the pool and turns it into a new puzzle by dropping clues, then
+    // reconstraining and minimizing. returns false if the attempt failed, or if it made a
+    // duplicate while deduplicating.
+    bool Attempt(char *puzzle) {
         char pattern[730];
-        uint32_t count = 0;
-
         size_t size = pattern_size;
-        for (uint64_t i = 0; i < options_.max_puzzles; i++) {
-            // draw a pattern from the pool
-            size_t which = util_.RandomUInt() % max_pattern;
-            memcpy(pattern, pattern_list + size * which, size);
-            memcpy(puzzle, pattern, size);
-            puzzle[size] = '\0';
-
-            // randomly drop clues to unconstrain
-            int dropped = 0;
-            for (int j : util_.Permutation(size)) {
-                if (dropped == options_.clues_to_drop) {
-                    break;
+
+        // draw a pattern from the pool
+        size_t which = util_.RandomUInt() % max_pattern;
+        memcpy(pattern, pattern_list.data() + size * which, size);
+        memcpy(puzzle, pattern, size);
+        puzzle[size] = '\0';
+
+        // randomly drop clues to unconstrain
+        int dropped = 0;
+        for (int j : util_.Permutation(size)) {
+            if (dropped == options_.clues_to_drop) {
+                break;
+            }
+            if (options_.mask) {
+                // drop a whole group of symmetric clues at a time.
+                if (puzzle[j] != '.' && options_.mask[j] != '.') {
+                    int group[4];
+                    int group_size = SymmetricGroup(j, options_.symmetry, options_.mask, group);
+                    for (int k = 0; k < group_size; k++) puzzle[group[k]] = '.';
+                    dropped++;
                 }
-                if (puzzle[j] == '.') {
-                    if (options_.pencilmark) {
-                        puzzle[j] = (char) ('1' + (j % 9));
-                        dropped++;
-                    }
-                } else {
-                    if (!options_.pencilmark) {
-                        puzzle[j] = '.';
-                        dropped++;
-                    }
+            } else if (puzzle[j] == '.') {
+                if (options_.pencilmark) {
+                    puzzle[j] = (char) ('1' + (j % 9));
+                    dropped++;
+                }
+            } else {
+                if (!options_.pencilmark) {
+                    puzzle[j] = '.';
+                    dropped++;
                 }
             }
+        }
 
-            // randomly complete and minimize
-            if (options_.clues_to_drop > 0) {
-                if (!TdokuConstrain(options_.pencilmark, puzzle)) {
-                    continue;
+        // randomly complete and minimize
+        if (options_.clues_to_drop > 0) {
+            if (options_.mask) {
+                if (!TdokuContextConstrainMasked(context_, options_.mask, options_.symmetry,
+                                                 puzzle)) {
+                    return false;
+                }
+                if (options_.minimize) {
+                    TdokuContextMinimizeMasked(context_, options_.mask, options_.symmetry, false,
+                                               puzzle);
+                }
+            } else {
+                if (!TdokuContextConstrain(context_, options_.pencilmark, puzzle)) {
+                    return false;
                 }
                 if (options_.minimize) {
-                    TdokuMinimize(options_.pencilmark, false, puzzle);
+                    TdokuContextMinimize(context_, options_.pencilmark, false, puzzle);
                 }
             }
+        }
 
-            // skip if the puzzle is the same as the pattern
-            if (options_.clues_to_drop > 0) {
-                if (strncmp(puzzle, pattern, size) == 0) {
-                    continue;
-                }
+        // skip if the puzzle is the same as the pattern
+        if (options_.clues_to_drop > 0) {
+            if (strncmp(puzzle, pattern, size) == 0) {
+                return false;
             }
+        }
+        return !dedup || dedup->Insert(puzzle, options_.pencilmark);
+    }
+
+    // makes up to max_attempts attempts, passing each accepted puzzle to emit(puzzle) as soon as
+    // it's found, and stops early after max_accepted puzzles or once the deadline has passed.
+    // a limit of 0 means no limit. returns the number of puzzles accepted.
+    template<typename EmitFn>
+    size_t Generate(uint64_t max_attempts, size_t max_accepted,
+                    chrono::steady_clock::time_point deadline, EmitFn emit) {
+        char puzzle[730];
+        size_t count = 0;
+        bool has_deadline = deadline != chrono::steady_clock::time_point::max();
 
-            // set separator
-            puzzle[size] = separator;
-            // copy to output, including separator
-            memcpy(output_puzzles + count * (size + 1), puzzle, size + 1);
+        size_t size = pattern_size;
+        for (uint64_t i = 0; max_attempts == 0 || i < max_attempts; i++) {
+            if (has_deadline && chrono::steady_clock::now() >= deadline) {
+                break;
+            }
+            if (!Attempt(puzzle)) {
+                continue;
+            }
+
+            emit(puzzle);
             count++;
 
             // store the new one randomly
-            which = util_.RandomUInt() % max_pattern;
-            memcpy(pattern_list + which * size, puzzle, size);
+            size_t which = util_.RandomUInt() % max_pattern;
+            memcpy(pattern_list.data() + which * size, puzzle, size);
+            pattern_loss[which] = numeric_limits<double>::infinity();
+
+            if (count == max_accepted) {
+                break;
+            }
+        }
+
+        return count;
+    }
+
+    // the mean of log(guesses + 1) over solves of random permutations of a vanilla puzzle, as
+    // TdokuRate takes it, giving up once the puzzle is sure to be rated above max_rating.
+    // returns false if it gave up, leaving *mean_log_guesses at the lower bound reached.
+    bool MeanLogGuessesUpTo(const char *puzzle, int max_rating, double *mean_log_guesses) {
+        char copy[82];
+        memcpy(copy, puzzle, 81);
+        copy[81] = '\0';
+        int num_evals = max(options_.num_evals, 1);
+        double max_sum = max_rating > 0 ? MeanLogGuessesAbove(max_rating) * num_evals :
+                         numeric_limits<double>::infinity();
+        int count = 0;
+        double sum = SumLogGuesses(context_, util_, copy, false, 0, num_evals, &count, max_sum);
+        *mean_log_guesses = sum / num_evals;
+        return sum < max_sum;
+    }
+
+    double Loss(uint32_t num_clues, double mean_log_guesses) {
+        return options_.clue_weight * num_clues - options_.guess_weight * mean_log_guesses +
+               options_.random_weight * util_.RandomDouble();
+    }
+
+    // like Generate, but scores each new vanilla puzzle and evolves the pool by replacing its
+    // worst pattern whenever a new puzzle scores better. puzzles are rated only if their clue
+    // count is in the window, and rating stops as soon as the puzzle is known to be too hard.
+    // rejected puzzles still compete for the pool with the part of their score we know, so the
+    // pool keeps moving towards the window. returns the number of records stored in output.
+    size_t GenerateScored(uint64_t max_attempts, GenerateOut9x9 *output) {
+        char puzzle[82];
+        size_t count = 0;
+
+        for (uint64_t i = 0; i < max_attempts; i++) {
+            if (!Attempt(puzzle)) {
+                continue;
+            }
+
+            uint32_t num_clues = 0;
+            for (int j = 0; j < 81; j++) num_clues += puzzle[j] != '.';
+            bool accept = (options_.min_clues == 0 || num_clues >= options_.min_clues) &&
+                          (options_.max_clues == 0 || num_clues <= options_.max_clues);
+            double mean_log_guesses = 0.0;
+            if (accept) {
+                accept = MeanLogGuessesUpTo(puzzle, options_.max_rating, &mean_log_guesses) &&
+                         Rating(mean_log_guesses) >= options_.min_rating;
+            }
+            double loss = Loss(num_clues, mean_log_guesses);
+
+            if (accept) {
+                GenerateOut9x9 &out = output[count++];
+                out.num_clues = num_clues;
+                out.mean_guesses = (float) expm1(mean_log_guesses);
+                out.loss = (float) loss;
+                memcpy(out.data, puzzle, 81);
+            }
+
+            size_t worst = max_element(pattern_loss.begin(), pattern_loss.end()) -
+                           pattern_loss.begin();
+            if (loss < pattern_loss[worst]) {
+                memcpy(pattern_list.data() + worst * pattern_size, puzzle, pattern_size);
+                pattern_loss[worst] = loss;
+            }
         }
 
         return count;
     }
+
+    // the pool is serialized as text: a header line "tdoku-pool 1 <pencilmark> <size>", then a
+    // line for each pattern holding the pattern and its loss separated by a space.
+    static constexpr const char *kPoolFormat = "tdoku-pool 1 %d %zu\n";
+
+    size_t Serialize(char *buffer, size_t buffer_size) const {
+        string text;
+        char line[64];
+        snprintf(line, sizeof(line), kPoolFormat, (int) options_.pencilmark, max_pattern);
+        text += line;
+        for (size_t i = 0; i < max_pattern; i++) {
+            text.append(pattern_list.data() + i * pattern_size, pattern_size);
+            snprintf(line, sizeof(line), " %.17g\n", pattern_loss[i]);
+            text += line;
+        }
+        if (buffer && buffer_size >= text.size()) {
+            memcpy(buffer, text.data(), text.size());
+        }
+        return text.size();
+    }
+
+    // replaces the pool, including its size, with a serialized one of the same kind of puzzle.
+    // leaves the pool unchanged and returns false if the buffer doesn't hold one.
+    bool Deserialize(const char *buffer, size_t buffer_size) {
+        string text(buffer, buffer_size);
+        int pencilmark = 0, header_size = 0;
+        size_t pool_size = 0;
+        if (sscanf(text.c_str(), "tdoku-pool 1 %d %zu\n%n", &pencilmark, &pool_size,
+                   &header_size) != 2 || header_size == 0 ||
+            pencilmark != (int) options_.pencilmark || pool_size == 0) {
+            return false;
+        }
+        vector<char> patterns;
+        vector<double> losses;
+        const char *next = text.c_str() + header_size;
+        const char *end = text.c_str() + text.size();
+        for (size_t i = 0; i < pool_size; i++) {
+            if ((size_t) (end - next) < pattern_size + 1 || next[pattern_size] != ' ') {
+                return false;
+            }
+            for (size_t j = 0; j < pattern_size; j++) {
+                if (next[j] != '.' && (next[j] < '1' || next[j] > '9')) return false;
+            }
+            patterns.insert(patterns.end(), next, next + pattern_size);
+            char *parsed;
+            losses.push_back(strtod(next + pattern_size + 1, &parsed));
+            if (parsed == next + pattern_size + 1 || *parsed != '\n') {
+                return false;
+            }
+            next = parsed + 1;
+        }
+        max_pattern = pool_size;
+        pattern_list.swap(patterns);
+        pattern_loss.swap(losses);
+        return true;
+    }
+
+    size_t Generate(char* output_puzzles, char separator) {
+        size_t size = pattern_size;
+        char *output = output_puzzles;
+        return Generate(options_.max_puzzles, 0, chrono::steady_clock::time_point::max(),
+                        [&](const char *puzzle) {
+                            // copy to output, followed by the separator
+                            memcpy(output, puzzle, size);
+                            output[size] = separator;
+                            output += size + 1;
+                        });
+    }
 };
 
+namespace {
+
+// the deadline for a run of max_seconds from now, or none if max_seconds isn't positive.
+chrono::steady_clock::time_point Deadline(double max_seconds) {
+    if (max_seconds <= 0) return chrono::steady_clock::time_point::max();
+    return chrono::steady_clock::now() + chrono::duration_cast<chrono::steady_clock::duration>(
+            chrono::duration<double>(max_seconds));
+}
+
+// a generator whose pool lives on between calls, along with the context it borrows from.
+struct GeneratorHandle {
+    TdokuContext *context;
+    Generator generator;
+
+    GeneratorHandle(TdokuContext *context, const Options &options, size_t pool_size)
+            : context(context), generator(options, context, pool_size) {
+        generator.InitEmpty();
+    }
+
+    ~GeneratorHandle() {
+        TdokuContextDestroy(context);
+    }
+};
+
+GeneratorHandle *AsHandle(TdokuGenerator *generator) {
+    return reinterpret_cast<GeneratorHandle *>(generator);
+}
+
+} // namespace
+
 extern "C"
-size_t TdokuGenerate(size_t num, bool pencilmark, uint64_t randomSeed, char* buffer, char separator){
+size_t TdokuContextGenerate(TdokuContext *context, size_t num, bool pencilmark, char* buffer,
+                            char separator){
     Options options = Options();
     options.pencilmark = pencilmark;
-    options.random_seed = randomSeed;
     options.max_puzzles = num;
-    Generator g(options);
+    Generator g(options, context);
+    g.InitEmpty();
+    return g.Generate(buffer, separator);
+}
+
+extern "C"
+size_t TdokuGenerate(size_t num, bool pencilmark, uint64_t randomSeed, char* buffer, char separator){
+    TdokuContext *context = TdokuContextCreate(randomSeed);
+    if (!context) return 0;
+    size_t count = TdokuContextGenerate(context, num, pencilmark, buffer, separator);
+    TdokuContextDestroy(context);
+    return count;
+}
+
+extern "C"
+size_t TdokuContextGenerateMasked(TdokuContext *context, size_t num, const char *mask,
+                                  int symmetry, char* buffer, char separator,
+                                  double *acceptance_rate){
+    Options options = Options();
+    options.max_puzzles = num;
+    options.mask = mask;
+    options.symmetry = symmetry;
+    Generator g(options, context);
+    g.InitEmpty();
+    size_t count = g.Generate(buffer, separator);
+    if (acceptance_rate) {
+        *acceptance_rate = num ? (double) count / (double) num : 0.0;
+    }
+    return count;
+}
+
+extern "C"
+size_t TdokuGenerateMasked(size_t num, const char *mask, int symmetry, uint64_t random_seed,
+                           char* buffer, char separator, double *acceptance_rate){
+    TdokuContext *context = TdokuContextCreate(random_seed);
+    if (!context) {
+        if (acceptance_rate) *acceptance_rate = 0.0;
+        return 0;
+    }
+    size_t count = TdokuContextGenerateMasked(context, num, mask, symmetry, buffer, separator,
+                                              acceptance_rate);
+    TdokuContextDestroy(context);
+    return count;
+}
+
+extern "C"
+size_t TdokuContextGenerateStream(TdokuContext *context, bool pencilmark, size_t max_puzzles,
+                                  uint64_t max_attempts, double max_seconds,
+                                  void (*callback)(const char *, void *), void *callback_arg){
+    if (max_puzzles == 0 && max_attempts == 0 && max_seconds <= 0) {
+        return 0;
+    }
+    Options options = Options();
+    options.pencilmark = pencilmark;
+    Generator g(options, context);
     g.InitEmpty();
+    return g.Generate(max_attempts, max_puzzles, Deadline(max_seconds),
+                      [&](const char *puzzle) { callback(puzzle, callback_arg); });
+}
+
+extern "C"
+size_t TdokuGenerateStream(bool pencilmark, uint64_t random_seed, size_t max_puzzles,
+                           uint64_t max_attempts, double max_seconds,
+                           void (*callback)(const char *, void *), void *callback_arg){
+    TdokuContext *context = TdokuContextCreate(random_seed);
+    if (!context) return 0;
+    size_t count = TdokuContextGenerateStream(context, pencilmark, max_puzzles, max_attempts,
+                                              max_seconds, callback, callback_arg);
+    TdokuContextDestroy(context);
+    return count;
+}
+
+namespace {
+
+Options ScoredOptions(const GenerateOptions9x9 *scoring) {
+    Options options = Options();
+    if (scoring) {
+        options.clue_weight = scoring->clue_weight;
+        options.guess_weight = scoring->guess_weight;
+        options.random_weight = scoring->random_weight;
+        options.clues_to_drop = scoring->clues_to_drop;
+        options.num_evals = scoring->num_evals;
+        options.min_clues = scoring->min_clues;
+        options.max_clues = scoring->max_clues;
+        options.min_rating = scoring->min_rating;
+        options.max_rating = scoring->max_rating;
+        options.dedup_bytes = scoring->dedup_bytes;
+    }
+    return options;
+}
+
+} // namespace
+
+extern "C"
+void TdokuGenerateOptionsDefault(GenerateOptions9x9 *options){
+    Options defaults = Options();
+    options->clue_weight = defaults.clue_weight;
+    options->guess_weight = defaults.guess_weight;
+    options->random_weight = defaults.random_weight;
+    options->clues_to_drop = defaults.clues_to_drop;
+    options->num_evals = defaults.num_evals;
+    options->min_clues = defaults.min_clues;
+    options->max_clues = defaults.max_clues;
+    options->min_rating = defaults.min_rating;
+    options->max_rating = defaults.max_rating;
+    options->dedup_bytes = defaults.dedup_bytes;
+}
+
+extern "C"
+size_t TdokuContextGenerateScored(TdokuContext *context, size_t num,
+                                  const GenerateOptions9x9 *options, GenerateOut9x9 *output){
+    Generator g(ScoredOptions(options), context);
+    g.InitEmpty();
+    return g.GenerateScored(num, output);
+}
+
+extern "C"
+size_t TdokuGenerateScored(size_t num, const GenerateOptions9x9 *options, uint64_t random_seed,
+                           GenerateOut9x9 *output){
+    TdokuContext *context = TdokuContextCreate(random_seed);
+    if (!context) return 0;
+    size_t count = TdokuContextGenerateScored(context, num, options, output);
+    TdokuContextDestroy(context);
+    return count;
+}
+
+namespace {
+
+// the seed of a worker's random number generator. worker 0 uses the caller's seed, so a single
+// worker generates the same puzzles as TdokuGenerate, and the others get well separated seeds
+// from splitmix64. a seed of 0 stays 0 so every worker seeds from std::random_device.
+uint64_t WorkerSeed(uint64_t seed, int worker) {
+    if (seed == 0 || worker == 0) return seed;
+    uint64_t z = seed + 0x9e3779b97f4a7c15ull * (uint64_t) worker;
+    z = (z ^ (z >> 30u)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27u)) * 0x94d049bb133111ebull;
+    z ^= z >> 31u;
+    return z ? z : 1;
+}
+
+} // namespace
+
+extern "C"
+size_t TdokuGenerateParallel(size_t num, bool pencilmark, uint64_t random_seed, int num_threads,
+                             char* buffer, char separator){
+    size_t stride = (pencilmark ? 729 : 81) + 1;
+    int num_workers = NumWorkers(num_threads);
+    if ((size_t) num_workers > num) num_workers = (int) max(num, (size_t) 1);
+
+    // each worker makes a fixed share of the attempts with its own context and pattern pool,
+    // writing into its share of the buffer, so the output depends only on the seed and the
+    // number of workers and not on how the threads are scheduled.
+    vector<size_t> counts(num_workers);
+    RunWorkers(num_workers, [&](int w) {
+        size_t begin = num * w / num_workers, end = num * (w + 1) / num_workers;
+        TdokuContext *context = TdokuContextCreate(WorkerSeed(random_seed, w));
+        if (!context) return; // leaves this worker's share empty
+        counts[w] = TdokuContextGenerate(context, end - begin, pencilmark,
+                                         buffer + begin * stride, separator);
+        TdokuContextDestroy(context);
+    });
+
+    // close the gaps left by attempts that didn't produce a puzzle.
+    size_t count = counts[0];
+    for (int w = 1; w < num_workers; w++) {
+        memmove(buffer + count * stride, buffer + num * w / num_workers * stride,
+                counts[w] * stride);
+        count += counts[w];
+    }
+    return count;
+}
+
+extern "C"
+TdokuGenerator *TdokuGeneratorCreate(bool pencilmark, size_t pool_size, uint64_t random_seed){
+    TdokuContext *context = TdokuContextCreate(random_seed);
+    if (!context) return nullptr;
+    Options options = Options();
+    options.pencilmark = pencilmark;
+    auto *handle = new GeneratorHandle(context, options, pool_size ? pool_size : 64);
+    return reinterpret_cast<TdokuGenerator *>(handle);
+}
+
+extern "C"
+void TdokuGeneratorDestroy(TdokuGenerator *generator){
+    delete AsHandle(generator);
+}
+
+extern "C"
+size_t TdokuGeneratorGenerate(TdokuGenerator *generator, size_t num, char* buffer,
+                              char separator){
+    Generator &g = AsHandle(generator)->generator;
+    g.options_.max_puzzles = num;
     return g.Generate(buffer, separator);
 }
+
+extern "C"
+size_t TdokuGeneratorGenerateStream(TdokuGenerator *generator, size_t max_puzzles,
+                                    uint64_t max_attempts, double max_seconds,
+                                    void (*callback)(const char *, void *), void *callback_arg){
+    if (max_puzzles == 0 && max_attempts == 0 && max_seconds <= 0) {
+        return 0;
+    }
+    return AsHandle(generator)->generator.Generate(
+            max_attempts, max_puzzles, Deadline(max_seconds),
+            [&](const char *puzzle) { callback(puzzle, callback_arg); });
+}
+
+extern "C"
+size_t TdokuGeneratorGenerateScored(TdokuGenerator *generator, size_t num,
+                                    const GenerateOptions9x9 *options, GenerateOut9x9 *output){
+    Generator &g = AsHandle(generator)->generator;
+    if (g.options_.pencilmark) return 0;
+    Options saved = g.options_;
+    g.options_ = ScoredOptions(options);
+    size_t count = g.GenerateScored(num, output);
+    g.options_ = saved;
+    return count;
+}
+
+extern "C"
+size_t TdokuGeneratorSerialize(const TdokuGenerator *generator, char *buffer,
+                               size_t buffer_size){
+    return reinterpret_cast<const GeneratorHandle *>(generator)->generator.Serialize(
+            buffer, buffer_size);
+}
+
+extern "C"
+bool TdokuGeneratorDeserialize(TdokuGenerator *generator, const char *buffer,
+                               size_t buffer_size){
+    return AsHandle(generator)->generator.Deserialize(buffer, buffer_size);
+}
+
+extern "C"
+void TdokuGeneratorSetDedup(TdokuGenerator *generator, size_t num_bytes){
+    Generator &g = AsHandle(generator)->generator;
+    if (num_bytes) {
+        g.dedup.reset(new DedupFilter(num_bytes));
+    } else {
+        g.dedup.reset();
+    }
+}
+
+extern "C"
+uint64_t TdokuGeneratorNumDuplicates(const TdokuGenerator *generator){
+    const Generator &g = reinterpret_cast<const GeneratorHandle *>(generator)->generator;
+    return g.dedup ? g.dedup->num_rejected : 0;
+}
@@ -1,9 +1,22 @@
 #include "grid_lib.h"
 #include "tdoku.h"
 
+#include <algorithm>
 #include <cmath>
 #include <cstdint>
 #include <cstring>
+#include <vector>
+#ifdef __SSE2__
+#include <immintrin.h>
+#endif
+
+struct GridSkipIndex {
+    const uint16_t *counts;
+    size_t num_patterns;
+    int log2_step;
+    // the id of the first grid of every 2^log2_step-th pattern, followed by the number of grids.
+    std::vector<uint64_t> starts;
+};
 
 namespace {
 
@@ -41,6 +54,115 @@ constexpr int n_band_configs = 28 * 6 * 6 * 6 * 6;
 int HorizIndexing(int x, int y) { return x * 9 + y; }
 int VertiIndexing(int x, int y) { return y * 9 + x; }
 
+// finds the pattern among the given counts that holds the grid *to_skip grids past the first
+// grid of the first pattern, and leaves in *to_skip the grid's offset within that pattern. the
+// grid must be within the n patterns, and together they must hold fewer than 2^31 grids.
+size_t ScanCounts(const uint16_t *counts, size_t n, uint32_t *to_skip) {
+    uint32_t remaining = *to_skip;
+    size_t i = 0;
+#ifdef __SSE2__
+    // take the prefix sums of 8 counts at a time as 32 bit integers, and find the first that
+    // passes the remaining grids.
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 8 <= n; i += 8) {
+        __m128i block = _mm_loadu_si128((const __m128i *) (counts + i));
+        __m128i lo = _mm_unpacklo_epi16(block, zero);
+        __m128i hi = _mm_unpackhi_epi16(block, zero);
+        lo = _mm_add_epi32(lo, _mm_slli_si128(lo, 4));
+        lo = _mm_add_epi32(lo, _mm_slli_si128(lo, 8));
+        hi = _mm_add_epi32(hi, _mm_slli_si128(hi, 4));
+        hi = _mm_add_epi32(hi, _mm_slli_si128(hi, 8));
+        hi = _mm_add_epi32(hi, _mm_shuffle_epi32(lo, 0xff));
+        __m128i threshold = _mm_set1_epi32((int) remaining);
+        int passed = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(lo, threshold))) |
+                     _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(hi, threshold))) << 4;
+        if (passed) {
+            alignas(16) uint32_t sums[8];
+            _mm_store_si128((__m128i *) sums, lo);
+            _mm_store_si128((__m128i *) (sums + 4), hi);
+            int lane = __builtin_ctz(passed);
+            *to_skip = lane ? remaining - sums[lane - 1] : remaining;
+            return i + lane;
+        }
+        remaining -= (uint32_t) _mm_cvtsi128_si32(_mm_shuffle_epi32(hi, 0xff));
+    }
+#endif
+    for (; remaining >= counts[i]; i++) remaining -= counts[i];
+    *to_skip = remaining;
+    return i;
+}
+
+// gets the grid at the given offset among the grids of the pattern, from a search starting at
+// whichever end of the pattern's grids is nearer. searching in reverse finds the same grids
+// in exactly the opposite order, so this enumerates at most half of them.
+void GetPatternGrid(size_t pattern_idx, size_t offset, size_t pattern_count, char *grid) {
+    char pattern[82];
+    GetPattern((int) pattern_idx, pattern);
+    size_t guesses;
+    if (offset < pattern_count / 2) {
+        SolveSudoku(pattern, offset + 1, 1, grid, &guesses);
+    } else {
+        SolveSudoku(pattern, pattern_count - offset, 3, grid, &guesses);
+    }
+}
+
+// finds the pattern of the grid with the given id, and the grid's offset among its grids.
+size_t LocateGrid(size_t grid_id, const GridSkipIndex *skip_index, size_t *offset) {
+    const std::vector<uint64_t> &starts = skip_index->starts;
+    size_t entry = std::upper_bound(starts.begin(), starts.end() - 1, grid_id) - starts.begin() - 1;
+    size_t first_pattern_idx = entry << (uint32_t) skip_index->log2_step;
+    size_t step = 1ull << (uint32_t) skip_index->log2_step;
+    size_t n = std::min(step, skip_index->num_patterns - first_pattern_idx);
+    uint32_t to_skip = (uint32_t) (grid_id - starts[entry]);
+    size_t pattern_idx = first_pattern_idx +
+                         ScanCounts(skip_index->counts + first_pattern_idx, n, &to_skip);
+    *offset = to_skip;
+    return pattern_idx;
+}
+
+struct GridRequest {
+    size_t pattern_idx;
+    size_t offset;
+    size_t position;
+};
+
+// gets the grids of requests sorted by offset within the same pattern, with a single
+// enumeration up to the last of them, unless separate searches from the nearer end of the
+// pattern's grids would take fewer solutions altogether.
+void GetPatternGrids(const GridRequest *requests, size_t num_requests, size_t pattern_count,
+                     char *grids) {
+    size_t pattern_idx = requests[0].pattern_idx;
+    size_t limit = requests[num_requests - 1].offset + 1;
+    size_t separate_cost = 0;
+    for (size_t i = 0; i < num_requests; i++) {
+        separate_cost += std::min(requests[i].offset + 1, pattern_count - requests[i].offset);
+    }
+    if (separate_cost <= limit) {
+        for (size_t i = 0; i < num_requests; i++) {
+            GetPatternGrid(pattern_idx, requests[i].offset, pattern_count,
+                           grids + requests[i].position * 81);
+        }
+        return;
+    }
+
+    char pattern[82];
+    GetPattern((int) pattern_idx, pattern);
+    size_t next_request = 0;
+    size_t grid_offset = 0;
+    auto collecting_callback = [&](const char *grid) {
+        // the same id may have been requested more than once.
+        while (next_request < num_requests && requests[next_request].offset == grid_offset) {
+            memcpy(grids + requests[next_request].position * 81, grid, 81);
+            next_request++;
+        }
+        grid_offset++;
+    };
+    // pass a thunk since we can't pass a capturing lambda as a function pointer
+    TdokuEnumerate(pattern, limit, [](const char *grid, void *thunked_callback) {
+        (*static_cast<decltype(collecting_callback)*>(thunked_callback))(grid);
+    }, &collecting_callback);
+}
+
 }  // namespace
 
 extern "C"
@@ -64,10 +186,64 @@ void GetGrid(size_t grid_idx, const void *index, const void *table, char *grid)
         current_pattern_idx++;
         pattern_count = *(((uint16_t *) table) + current_pattern_idx);
     }
-    char pattern[82];
-    GetPattern(current_pattern_idx, pattern);
-    size_t guesses;
-    SolveSudoku(pattern, to_skip + 1, 1, grid, &guesses);
+    GetPatternGrid(current_pattern_idx, to_skip, pattern_count, grid);
+}
+
+extern "C"
+GridSkipIndex *GridSkipIndexCreate(const void *table, size_t num_patterns, int log2_step) {
+    auto *skip_index = new GridSkipIndex();
+    skip_index->counts = (const uint16_t *) table;
+    skip_index->num_patterns = num_patterns;
+    skip_index->log2_step = std::min(std::max(log2_step, 0), 14);
+    size_t step = 1ull << (uint32_t) skip_index->log2_step;
+    skip_index->starts.reserve((num_patterns + step - 1) / step + 1);
+    uint64_t num_grids = 0;
+    for (size_t i = 0; i < num_patterns; i++) {
+        if (i % step == 0) skip_index->starts.push_back(num_grids);
+        num_grids += skip_index->counts[i];
+    }
+    skip_index->starts.push_back(num_grids);
+    return skip_index;
+}
+
+extern "C"
+void GridSkipIndexDestroy(GridSkipIndex *skip_index) {
+    delete skip_index;
+}
+
+extern "C"
+size_t GridSkipIndexNumGrids(const GridSkipIndex *skip_index) {
+    return skip_index->starts.back();
+}
+
+extern "C"
+void GetGridSkipIndexed(size_t grid_id, const GridSkipIndex *skip_index, char *grid) {
+    size_t offset;
+    size_t pattern_idx = LocateGrid(grid_id, skip_index, &offset);
+    GetPatternGrid(pattern_idx, offset, skip_index->counts[pattern_idx], grid);
+}
+
+extern "C"
+void GetGridsSkipIndexed(const size_t *grid_ids, size_t count, const GridSkipIndex *skip_index,
+                         char *grids) {
+    std::vector<size_t> order(count);
+    for (size_t i = 0; i < count; i++) order[i] = i;
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return grid_ids[a] < grid_ids[b];
+    });
+    std::vector<GridRequest> requests(count);
+    for (size_t i = 0; i < count; i++) {
+        GridRequest &request = requests[i];
+        request.position = order[i];
+        request.pattern_idx = LocateGrid(grid_ids[order[i]], skip_index, &request.offset);
+    }
+    for (size_t first = 0, last; first < count; first = last) {
+        for (last = first + 1; last < count; last++) {
+            if (requests[last].pattern_idx != requests[first].pattern_idx) break;
+        }
+        GetPatternGrids(&requests[first], last - first,
+                        skip_index->counts[requests[first].pattern_idx], grids);
+    }
 }
 
 extern "C"
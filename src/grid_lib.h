@@ -13,6 +13,44 @@ extern "C"
 #endif
 void GetGrid(size_t grid_id, const void *index, const void *table, char *grid);
 
+// an index of the running total of grids at every 2^log2_step-th pattern of a table of pattern
+// counts, for finding a grid's pattern with a binary search and a scan of at most 2^log2_step
+// counts rather than a walk from the nearest entry of the grid index.
+typedef struct GridSkipIndex GridSkipIndex;
+
+// builds the skip index for a table of num_patterns counts, which must outlive it. log2_step
+// is clamped to [0, 14]. the index takes 8 bytes per 2^log2_step patterns.
+#ifdef __cplusplus
+extern "C"
+#endif
+GridSkipIndex *GridSkipIndexCreate(const void *table, size_t num_patterns, int log2_step);
+
+#ifdef __cplusplus
+extern "C"
+#endif
+void GridSkipIndexDestroy(GridSkipIndex *skip_index);
+
+// the number of grids counted by the table of the skip index.
+#ifdef __cplusplus
+extern "C"
+#endif
+size_t GridSkipIndexNumGrids(const GridSkipIndex *skip_index);
+
+// same as GetGrid, but finds the grid's pattern through the skip index.
+#ifdef __cplusplus
+extern "C"
+#endif
+void GetGridSkipIndexed(size_t grid_id, const GridSkipIndex *skip_index, char *grid);
+
+// gets count grids at once, the grid with id grid_ids[i] going to grids + i * 81. the ids are
+// sorted internally, so that ids falling in the same pattern are served by one enumeration of
+// its grids instead of a search each.
+#ifdef __cplusplus
+extern "C"
+#endif
+void GetGridsSkipIndexed(const size_t *grid_ids, size_t count, const GridSkipIndex *skip_index,
+                         char *grids);
+
 #ifdef __cplusplus
 extern "C"
 #endif
@@ -1,6 +1,10 @@
 #include "grid_lib.h"
+#include "parallel.h"
 #include "tdoku.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <cstring>
 #include <fcntl.h>
 #include <fstream>
@@ -8,6 +12,8 @@
 #include <random>
 #include <sys/mman.h>
 #include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
 
 using namespace std;
 
@@ -19,18 +25,172 @@ void ListPatterns(uint64_t pattern_id, uint64_t limit) {
     }
 }
 
-void CountGrids(int start, int limit) {
+void CountGrids(int start, int limit, int num_threads) {
     char pattern[82];
     char solution[82];
     size_t guesses;
 
     for (int pattern_idx = start; pattern_idx < start + limit; pattern_idx++) {
         GetPattern(pattern_idx, pattern);
-        int count = SolveSudoku(pattern, 100000, 0, solution, &guesses);
+        int count = num_threads == 1 ?
+                    SolveSudoku(pattern, 100000, 0, solution, &guesses) :
+                    TdokuCountParallel(pattern, 100000, num_threads, &guesses);
         printf("%d\t%d\n", pattern_idx, count);
     }
 }
 
+// count_range counts this many patterns per worker between checkpoints.
+constexpr uint64_t patterns_per_worker_round = 1024;
+
+// the pattern range of a count_range run, the first pattern not yet counted, and the size of
+// the counts file once the patterns before it were written.
+struct Checkpoint {
+    uint64_t first;
+    uint64_t last;
+    uint64_t next;
+    uint64_t bytes;
+};
+
+bool ReadCheckpoint(const string &path, Checkpoint *checkpoint) {
+    ifstream file(path);
+    return (bool) (file >> checkpoint->first >> checkpoint->last >> checkpoint->next >>
+                   checkpoint->bytes);
+}
+
+// flushes a file's buffered writes to disk, stopping with an error if any of them failed.
+void SyncFile(FILE *file, const string &path) {
+    if (ferror(file) || fflush(file) != 0 || fsync(fileno(file)) != 0) {
+        cerr << "Could not write file: " << path << endl;
+        exit(1);
+    }
+}
+
+// writes the checkpoint to a new file that replaces the old one, so that an interrupted write
+// leaves the previous checkpoint in place. the directory is synced too, so the replacement
+// itself survives a crash.
+void WriteCheckpoint(const string &path, const Checkpoint &checkpoint) {
+    string temp_path = path + ".tmp";
+    FILE *file = fopen(temp_path.c_str(), "w");
+    if (!file) {
+        cerr << "Could not write checkpoint: " << temp_path << endl;
+        exit(1);
+    }
+    fprintf(file, "%llu %llu %llu %llu\n", (unsigned long long) checkpoint.first,
+            (unsigned long long) checkpoint.last, (unsigned long long) checkpoint.next,
+            (unsigned long long) checkpoint.bytes);
+    SyncFile(file, temp_path);
+    if (fclose(file) != 0) {
+        cerr << "Could not write checkpoint: " << temp_path << endl;
+        exit(1);
+    }
+    if (rename(temp_path.c_str(), path.c_str()) != 0) {
+        cerr << "Could not replace checkpoint: " << path << endl;
+        exit(1);
+    }
+    size_t slash = path.find_last_of('/');
+    string directory = slash == string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+    int fd = open(directory.c_str(), O_RDONLY);
+    if (fd < 0 || fsync(fd) != 0) {
+        cerr << "Could not sync directory: " << directory << endl;
+        exit(1);
+    }
+    close(fd);
+}
+
+string FormatSeconds(double seconds) {
+    auto total = (long long) seconds;
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%lld:%02lld:%02lld", total / 3600, total / 60 % 60,
+             total % 60);
+    return buffer;
+}
+
+// counts the grids of the patterns in range(first, last) on num_threads threads, writing them
+// to counts_path in the format of count_grids. the patterns are counted in rounds, and after
+// each round its counts are written in order and a checkpoint is saved next to the counts. a
+// run with the same arguments after an interruption resumes from the checkpoint.
+void CountRange(uint64_t first, uint64_t last, int num_threads, const char *counts_path) {
+    string checkpoint_path = string(counts_path) + ".checkpoint";
+    Checkpoint checkpoint{first, last, first, 0};
+    FILE *counts;
+    if (ReadCheckpoint(checkpoint_path, &checkpoint)) {
+        if (checkpoint.first != first || checkpoint.last != last) {
+            cerr << checkpoint_path << " is for patterns " << checkpoint.first << " to "
+                 << checkpoint.last << endl;
+            exit(1);
+        }
+        // drop anything written after the checkpoint, which may end in a partial line.
+        if (truncate(counts_path, (off_t) checkpoint.bytes) != 0) {
+            cerr << "Could not truncate file: " << counts_path << endl;
+            exit(1);
+        }
+        counts = fopen(counts_path, "a");
+        cerr << "resuming at pattern " << checkpoint.next << endl;
+    } else {
+        struct stat statbuf;
+        if (stat(counts_path, &statbuf) == 0) {
+            cerr << counts_path << " exists without a checkpoint, not overwriting it" << endl;
+            exit(1);
+        }
+        counts = fopen(counts_path, "w");
+    }
+    if (!counts) {
+        cerr << "Could not open file: " << counts_path << endl;
+        exit(1);
+    }
+
+    int num_workers = NumWorkers(num_threads);
+    uint64_t resumed_at = checkpoint.next;
+    auto start_time = chrono::steady_clock::now();
+    auto last_report = start_time;
+    vector<uint32_t> round_counts;
+    while (checkpoint.next < last) {
+        uint64_t round_first = checkpoint.next;
+        uint64_t round_size = min(last - round_first, patterns_per_worker_round * num_workers);
+        round_counts.assign(round_size, 0);
+        int round_workers = (int) min((uint64_t) num_workers, round_size);
+        WorkStealingRanges ranges(round_size, round_workers);
+        RunWorkers(round_workers, [&](int w) {
+            char pattern[82];
+            char solution[82];
+            size_t guesses;
+            size_t i;
+            while (ranges.Next(w, &i)) {
+                GetPattern((int) (round_first + i), pattern);
+                round_counts[i] = SolveSudoku(pattern, 100000, 0, solution, &guesses);
+            }
+        });
+
+        for (uint64_t i = 0; i < round_size; i++) {
+            fprintf(counts, "%llu\t%u\n", (unsigned long long) (round_first + i),
+                    round_counts[i]);
+        }
+        SyncFile(counts, counts_path);
+        checkpoint.next += round_size;
+        checkpoint.bytes = (uint64_t) ftello(counts);
+        WriteCheckpoint(checkpoint_path, checkpoint);
+
+        auto now = chrono::steady_clock::now();
+        if (now - last_report >= chrono::seconds(10) || checkpoint.next == last) {
+            last_report = now;
+            double elapsed = chrono::duration<double>(now - start_time).count();
+            double rate = (double) (checkpoint.next - resumed_at) / elapsed;
+            cerr << "counted " << checkpoint.next - first << " of " << last - first
+                 << " patterns (" << 100.0 * (checkpoint.next - first) / (last - first)
+                 << "%), ";
+            // a round too quick for the clock gives no rate to estimate from.
+            if (isfinite(rate) && rate > 0.0) {
+                cerr << (uint64_t) rate << " patterns/s, elapsed " << FormatSeconds(elapsed)
+                     << ", eta " << FormatSeconds((double) (last - checkpoint.next) / rate);
+            } else {
+                cerr << "elapsed " << FormatSeconds(elapsed);
+            }
+            cerr << endl;
+        }
+    }
+    fclose(counts);
+}
+
 constexpr int index_step = 1024 * 1024;
 
 void MakeTables() {
@@ -64,7 +224,7 @@ void MakeTables() {
     table_index.close();
 }
 
-void *MMapFile(const char *file_path) {
+void *MMapFile(const char *file_path, size_t *size = nullptr) {
     int fd = open(file_path, O_RDONLY);
     if (fd < 0) {
         cout << "Could not open file: " << file_path << endl;
@@ -78,6 +238,7 @@ void *MMapFile(const char *file_path) {
         exit(1);
     }
     madvise(mapped, statbuf.st_size, MADV_WILLNEED);
+    if (size) *size = statbuf.st_size;
     return mapped;
 }
 
@@ -98,16 +259,42 @@ namespace {
     std::uniform_int_distribution<uint64_t> random_uint{};
 }
 
+// the granularity of the skip index used for sampling. at one entry per 256 patterns it takes
+// about 40MB for the full table.
+constexpr int skip_index_log2_step = 8;
+
+GridSkipIndex *LoadSkipIndex() {
+    size_t table_size;
+    void *table = MMapFile("grid.counts", &table_size);
+    return GridSkipIndexCreate(table, table_size / sizeof(uint16_t), skip_index_log2_step);
+}
+
+// grids are sampled in batches, so that ids falling in the same pattern share its search.
+constexpr int64_t sample_batch_size = 1 << 16;
+
+// samples a batch of grids, limited to the given number if it's not negative.
+void SampleGridBatch(const GridSkipIndex *skip_index, int64_t limit, vector<size_t> &grid_ids,
+                     vector<char> &grids) {
+    size_t batch_size = limit < 0 ? sample_batch_size : min(limit, sample_batch_size);
+    grid_ids.resize(batch_size);
+    for (size_t &grid_id : grid_ids) grid_id = random_uint(rng) % num_equivalence_classes;
+    grids.resize(batch_size * 81);
+    GetGridsSkipIndexed(grid_ids.data(), batch_size, skip_index, grids.data());
+}
+
 void SampleGrids(int64_t limit) {
-    void *table = MMapFile("grid.counts");
-    void *index = MMapFile("grid.index");
+    GridSkipIndex *skip_index = LoadSkipIndex();
 
-    char grid[81];
-    while (limit-- != 0) {
-        size_t grid_id = random_uint(rng) % num_equivalence_classes;
-        GetGrid(grid_id, index, table, grid);
-        printf("%.81s\t%zu\n", grid, grid_id);
+    vector<size_t> grid_ids;
+    vector<char> grids;
+    while (limit != 0) {
+        SampleGridBatch(skip_index, limit, grid_ids, grids);
+        for (size_t i = 0; i < grid_ids.size(); i++) {
+            printf("%.81s\t%zu\n", &grids[i * 81], grid_ids[i]);
+        }
+        if (limit > 0) limit -= grid_ids.size();
     }
+    GridSkipIndexDestroy(skip_index);
 }
 
 // when sampling a grid each equally probable permutation leads to exactly zero or one
@@ -122,21 +309,25 @@ static double SamplingWeight(int clues) {
 }
 
 void SamplePuzzles(int64_t limit) {
-    void *table = MMapFile("grid.counts");
-    void *index = MMapFile("grid.index");
+    GridSkipIndex *skip_index = LoadSkipIndex();
 
-    char grid[81];
+    vector<size_t> grid_ids;
+    vector<char> grids;
     while (limit != 0) {
-        size_t grid_id = random_uint(rng) % num_equivalence_classes;
-        GetGrid(grid_id, index, table, grid);
-        if (TdokuMinimize(false, true, grid)) {
-            int num_clues = 0;
-            for (char c : grid) num_clues += (c != '.');
-            double weight = SamplingWeight(num_clues);
-            printf("%.81s\t%f\n", grid, weight);
-            limit--;
+        // the rejection rate isn't known in advance, so always sample full batches.
+        SampleGridBatch(skip_index, -1, grid_ids, grids);
+        for (size_t i = 0; i < grid_ids.size() && limit != 0; i++) {
+            char *grid = &grids[i * 81];
+            if (TdokuMinimize(false, true, grid)) {
+                int num_clues = 0;
+                for (int j = 0; j < 81; j++) num_clues += (grid[j] != '.');
+                double weight = SamplingWeight(num_clues);
+                printf("%.81s\t%f\n", grid, weight);
+                limit--;
+            }
         }
     }
+    GridSkipIndexDestroy(skip_index);
 }
 
 void usage() {
@@ -167,7 +358,20 @@ pre-generated tables you can skip this step and the next.
   wait
 
 Adjust the parallelism used above as appropriate for your platform. On a
-Threadripper 2990WX with 64 processes this takes about 8 hours.
+Threadripper 2990WX with 64 processes this takes about 8 hours. An optional
+fourth argument to count_grids splits the search for each pattern across that
+many threads (0 for one per hardware thread), for use with fewer processes.
+
+Alternatively count a range of patterns in one process, on a number of threads
+(0 for one per hardware thread), writing the counts to a file:
+
+  build/grid_tools count_range 0 $((36228 * 36228)) 0 grid_counts.txt
+
+This reports progress and an estimate of the time remaining as it goes, and
+saves a checkpoint in grid_counts.txt.checkpoint after every 1024 patterns per
+thread. If it's interrupted, running the same command again resumes from
+there. The counts file can be passed to make_tables in place of the chunks
+below.
 
 Now make the tables, taking care to consume the chunks of counts in order:
 
@@ -179,6 +383,9 @@ any numbered grid in range(27704267971*2^7), or you can sample grids randomly:
   build/grid_tools list_grids <first_gird_id> [<limit>=1]
   build/grid_tools sample_grids [<limit>=-1]
 
+Sampling only needs grid.counts, from which it builds a finer index in memory
+when it starts.
+
 You can also sample minimal puzzles via a very slow rejection sampling procedure
 like so:
 
@@ -199,10 +406,19 @@ int main(int argc, char **argv) {
                 return 0;
             }
         } else if (command == "count_grids") {
-            if (argc == 4) {
+            if (argc == 4 || argc == 5) {
                 int start = stoi(argv[2]);
                 int limit = stoi(argv[3]);
-                CountGrids(start, limit);
+                int num_threads = argc > 4 ? stoi(argv[4]) : 1;
+                CountGrids(start, limit, num_threads);
+                return 0;
+            }
+        } else if (command == "count_range") {
+            if (argc == 6) {
+                uint64_t first = stoull(argv[2]);
+                uint64_t last = stoull(argv[3]);
+                int num_threads = stoi(argv[4]);
+                CountRange(first, last, num_threads, argv[5]);
                 return 0;
             }
         } else if (command == "make_tables") {
@@ -0,0 +1,116 @@
+#ifndef TDOKU_PARALLEL_H
+#define TDOKU_PARALLEL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// the number of workers to use for a requested thread count, where 0 means one worker per
+// hardware thread.
+inline int NumWorkers(int num_threads) {
+    if (num_threads > 0) return num_threads;
+    int hardware_threads = (int) std::thread::hardware_concurrency();
+    return hardware_threads > 0 ? hardware_threads : 1;
+}
+
+// runs worker(w) for each w in range(num_workers), on num_workers - 1 new threads and the
+// calling thread, and returns once all of them have finished.
+template<typename WorkerFn>
+void RunWorkers(int num_workers, WorkerFn worker) {
+    std::vector<std::thread> threads;
+    threads.reserve(num_workers - 1);
+    for (int w = 1; w < num_workers; w++) {
+        threads.emplace_back([&worker, w]() { worker(w); });
+    }
+    worker(0);
+    for (auto &thread : threads) thread.join();
+}
+
+// hands out the indices in range(count) to a fixed set of workers. each worker starts with an
+// even, contiguous share of the range and takes indices from the front of it. a worker whose
+// share is exhausted steals the back half of the largest share remaining with another worker,
+// so a few slow items don't leave the other workers idle at the end of a batch.
+//
+// the bounds of each share are packed into one 64-bit word so owner and thieves can update
+// them with a single compare-and-swap. as a consequence count must be less than 2^32.
+class WorkStealingRanges {
+    struct Share {
+        std::atomic<uint64_t> bounds{0};
+        char padding[64 - sizeof(std::atomic<uint64_t>)]; // keep shares on separate lines
+    };
+
+    static uint64_t Pack(uint64_t begin, uint64_t end) { return end << 32u | begin; }
+    static uint32_t Begin(uint64_t bounds) { return (uint32_t) bounds; }
+    static uint32_t End(uint64_t bounds) { return (uint32_t) (bounds >> 32u); }
+
+    int num_workers_;
+    std::unique_ptr<Share[]> shares_;
+
+public:
+    static constexpr size_t kMaxCount = UINT32_MAX;
+
+    WorkStealingRanges(size_t count, int num_workers)
+            : num_workers_(num_workers), shares_(new Share[num_workers]) {
+        for (int w = 0; w < num_workers; w++) {
+            shares_[w].bounds = Pack(count * w / num_workers, count * (w + 1) / num_workers);
+        }
+    }
+
+    // sets *index to the next index for the given worker. returns false once no work remains.
+    bool Next(int worker, size_t *index) {
+        std::atomic<uint64_t> &own = shares_[worker].bounds;
+        uint64_t bounds = own.load();
+        while (Begin(bounds) < End(bounds)) {
+            if (own.compare_exchange_weak(bounds, Pack(Begin(bounds) + 1, End(bounds)))) {
+                *index = Begin(bounds);
+                return true;
+            }
+        }
+        return Steal(worker, index);
+    }
+
+private:
+    bool Steal(int worker, size_t *index) {
+        while (true) {
+            int victim = -1;
+            uint64_t victim_bounds = 0;
+            uint32_t most_remaining = 1; // leave single items to their owner
+            for (int w = 0; w < num_workers_; w++) {
+                uint64_t bounds = shares_[w].bounds.load();
+                if (w != worker && End(bounds) - Begin(bounds) > most_remaining) {
+                    most_remaining = End(bounds) - Begin(bounds);
+                    victim = w;
+                    victim_bounds = bounds;
+                }
+            }
+            if (victim < 0) {
+                // nothing left worth stealing; take any single item still sitting in a share.
+                for (int w = 0; w < num_workers_; w++) {
+                    uint64_t bounds = shares_[w].bounds.load();
+                    while (Begin(bounds) < End(bounds)) {
+                        if (shares_[w].bounds.compare_exchange_weak(
+                                bounds, Pack(Begin(bounds) + 1, End(bounds)))) {
+                            *index = Begin(bounds);
+                            return true;
+                        }
+                    }
+                }
+                return false;
+            }
+            uint32_t begin = Begin(victim_bounds), end = End(victim_bounds);
+            uint32_t middle = begin + (end - begin) / 2;
+            if (shares_[victim].bounds.compare_exchange_strong(victim_bounds,
+                                                               Pack(begin, middle))) {
+                // nobody else touches an empty share, so our own bounds can't have changed.
+                shares_[worker].bounds.store(Pack(middle + 1, end));
+                *index = middle;
+                return true;
+            }
+        }
+    }
+};
+
+#endif //TDOKU_PARALLEL_H
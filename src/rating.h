@@ -0,0 +1,28 @@
+#ifndef TDOKU_RATING_H
+#define TDOKU_RATING_H
+
+#include "../include/tdoku.h"
+#include <limits>
+
+class Util;
+
+// library-internal access to the rating machinery of TdokuRate, so scored generation rates
+// puzzles the same way.
+
+// the sum of log(guesses + 1) over num_evals solves of random permutations of the puzzle, and
+// in *count the number of those the solver supports. stops early once the sum reaches max_sum.
+double SumLogGuesses(TdokuContext *context, Util &util, const char *puzzle, bool pencilmark,
+                     int solver, int num_evals, int *count,
+                     double max_sum = std::numeric_limits<double>::infinity());
+
+// the mean of log(guesses + 1) over the solves of SumLogGuesses, or 0 if there were none.
+double MeanLogGuesses(TdokuContext *context, Util &util, const char *puzzle, bool pencilmark,
+                      int solver, int num_evals);
+
+// the rating of a mean of log(guesses + 1).
+int Rating(double mean_log_guesses);
+
+// the least mean of log(guesses + 1) rated above the given rating.
+double MeanLogGuessesAbove(int rating);
+
+#endif //TDOKU_RATING_H
@@ -0,0 +1,27 @@
+#ifndef TDOKU_RATING_MODEL_H
+#define TDOKU_RATING_MODEL_H
+
+// generated by fit_rating_model -n 100 -s 1: weights of the features from
+// TdokuRateFeatures in a linear estimate of TdokuRate with num_evals = 100, fitted to
+// 20000 generated puzzles (seed 1).
+// on 4000 held out puzzles: mean absolute error 40, rms error 79, r^2 0.89.
+
+namespace {
+
+constexpr float kRatingModel[TDOKU_NUM_RATE_FEATURES] = {
+        64.6135f,
+        0.405868f,
+        5.07106f,
+        0.430169f,
+        -6.34276f,
+        0.885295f,
+        -0.681074f,
+        0.572598f,
+        8.18305f,
+        109.535f,
+        -74.0507f
+};
+
+} // namespace
+
+#endif //TDOKU_RATING_MODEL_H
@@ -0,0 +1,149 @@
+#include "../include/tdoku.h"
+
+#include <cstring>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+using namespace std;
+
+namespace {
+
+// an LRU cache of solve and rate results for vanilla puzzles, keyed by canonical form so that
+// every puzzle equivalent to one seen before hits. solutions are stored for the canonical form
+// and mapped back to each puzzle through the inverse of its transform. results are computed
+// outside the lock, so two threads missing on the same puzzle may both compute it.
+class ResultCache {
+public:
+    explicit ResultCache(size_t capacity) : capacity_(capacity) {}
+
+    size_t Solve(const char *input, char *solution) {
+        char canonical[81];
+        uint8_t transform[28];
+        TdokuCanonicalize(input, canonical, transform);
+        string key = Key(canonical, 's', 0, 0);
+
+        Entry entry;
+        if (!Lookup(key, &entry)) {
+            char puzzle[82];
+            memcpy(puzzle, canonical, 81);
+            puzzle[81] = '\0';
+            entry.count = TdokuSolve(puzzle, false, entry.solution);
+            Insert(key, entry);
+        }
+        if (entry.count > 0) {
+            TdokuTransform(entry.solution, transform, true, solution);
+        }
+        return entry.count;
+    }
+
+    int Rate(const char *input, int solver, int num_evals) {
+        // ratings average over random permutations, so the transform doesn't matter here.
+        char canonical[81];
+        TdokuCanonicalize(input, canonical, nullptr);
+        string key = Key(canonical, 'r', solver, num_evals);
+
+        Entry entry;
+        if (!Lookup(key, &entry)) {
+            char puzzle[82];
+            memcpy(puzzle, canonical, 81);
+            puzzle[81] = '\0';
+            entry.rating = TdokuRate(puzzle, false, solver, num_evals);
+            Insert(key, entry);
+        }
+        return entry.rating;
+    }
+
+    void Stats(uint64_t *hits, uint64_t *misses) {
+        lock_guard<mutex> lock(mutex_);
+        if (hits) *hits = hits_;
+        if (misses) *misses = misses_;
+    }
+
+private:
+    struct Entry {
+        size_t count = 0;
+        char solution[81]{};
+        int rating = 0;
+    };
+    using Item = pair<string, Entry>;
+
+    size_t capacity_;
+    mutex mutex_;
+    list<Item> items_;  // most recently used first
+    unordered_map<string, list<Item>::iterator> index_;
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+
+    // the canonical form followed by the kind of result and the parameters it depends on.
+    static string Key(const char *canonical, char kind, int solver, int num_evals) {
+        string key(canonical, 81);
+        key += kind;
+        key.append((const char *) &solver, sizeof(solver));
+        key.append((const char *) &num_evals, sizeof(num_evals));
+        return key;
+    }
+
+    bool Lookup(const string &key, Entry *entry) {
+        lock_guard<mutex> lock(mutex_);
+        auto it = index_.find(key);
+        if (it == index_.end()) {
+            misses_++;
+            return false;
+        }
+        hits_++;
+        items_.splice(items_.begin(), items_, it->second);
+        *entry = it->second->second;
+        return true;
+    }
+
+    void Insert(const string &key, const Entry &entry) {
+        lock_guard<mutex> lock(mutex_);
+        if (capacity_ == 0 || index_.count(key)) return;
+        if (items_.size() == capacity_) {
+            index_.erase(items_.back().first);
+            items_.pop_back();
+        }
+        items_.emplace_front(key, entry);
+        index_[key] = items_.begin();
+    }
+};
+
+ResultCache *AsCache(TdokuCache *cache) {
+    return reinterpret_cast<ResultCache *>(cache);
+}
+
+} // namespace
+
+extern "C"
+TdokuCache *TdokuCacheCreate(size_t capacity){
+    return reinterpret_cast<TdokuCache *>(new ResultCache(capacity));
+}
+
+extern "C"
+void TdokuCacheDestroy(TdokuCache *cache){
+    delete AsCache(cache);
+}
+
+extern "C"
+size_t TdokuCacheSolve(TdokuCache *cache, const char* input, bool pencilmark, char* solution){
+    if (pencilmark) {
+        return TdokuSolve(input, pencilmark, solution);
+    }
+    return AsCache(cache)->Solve(input, solution);
+}
+
+extern "C"
+int TdokuCacheRate(TdokuCache *cache, const char *input, bool pencilmark, int solver,
+                   int num_evals){
+    if (pencilmark) {
+        return TdokuRate(input, pencilmark, solver, num_evals);
+    }
+    return AsCache(cache)->Rate(input, solver, num_evals);
+}
+
+extern "C"
+void TdokuCacheStats(TdokuCache *cache, uint64_t *hits, uint64_t *misses){
+    AsCache(cache)->Stats(hits, misses);
+}
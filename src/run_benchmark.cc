@@ -209,6 +209,8 @@ struct Benchmark {
 
     void OutputHeader(const string &filename) {
         if (!options_.csv_output) {
+            cout << endl << "tdoku copies " << TdokuStateBytesCopiedPerGuess()
+                 << " bytes of state per guess" << endl;
             cout << endl << "|" << left << setw(37) << filename << " ";
             cout << "|  puzzles/sec|  usec/puzzle|   %no_guess|  guesses/puzzle|" << endl;
             cout << "|--------------------------------------"
@@ -0,0 +1,89 @@
+#include "simd_dispatch.h"
+
+#include "../include/tdoku.h"
+#include "context.h"
+
+#include <cstdlib>
+#include <cstring>
+
+// declarations of the functions defined by each variant of solver_dpll_triad_simd.cc.
+#define DECLARE_VARIANTS(ret, name, params, args) \
+    ret name##_sse2 params; \
+    ret name##_sse4_1 params; \
+    ret name##_avx2 params; \
+    ret name##_avx512 params;
+extern "C" {
+TDOKU_SIMD_FUNCTIONS(DECLARE_VARIANTS)
+}
+#undef DECLARE_VARIANTS
+
+namespace {
+
+struct SimdFunctions {
+#define MEMBER(ret, name, params, args) ret (*name) params;
+    TDOKU_SIMD_FUNCTIONS(MEMBER)
+#undef MEMBER
+};
+
+#define SSE2(ret, name, params, args) name##_sse2,
+#define SSE4_1(ret, name, params, args) name##_sse4_1,
+#define AVX2(ret, name, params, args) name##_avx2,
+#define AVX512(ret, name, params, args) name##_avx512,
+// in increasing order of the instruction sets they need.
+const SimdFunctions kVariants[] = {
+        {TDOKU_SIMD_FUNCTIONS(SSE2)},
+        {TDOKU_SIMD_FUNCTIONS(SSE4_1)},
+        {TDOKU_SIMD_FUNCTIONS(AVX2)},
+        {TDOKU_SIMD_FUNCTIONS(AVX512)},
+};
+#undef SSE2
+#undef SSE4_1
+#undef AVX2
+#undef AVX512
+
+// index of the best variant this CPU supports. the avx512 variant is also compiled with bitalg
+// and bw, and every CPU with bitalg has those, but check them all.
+int SupportedVariant() {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512vl") && __builtin_cpu_supports("avx512bw") &&
+        __builtin_cpu_supports("avx512bitalg")) {
+        return 3;
+    }
+    if (__builtin_cpu_supports("avx2")) return 2;
+    if (__builtin_cpu_supports("sse4.1")) return 1;
+    return 0;
+}
+
+// the best supported variant, or a lower one if the TDOKU_SIMD environment variable names it.
+// unknown names and names of unsupported variants are ignored.
+const SimdFunctions &SelectVariant() {
+    int selected = SupportedVariant();
+    const char *requested = getenv("TDOKU_SIMD");
+    if (requested) {
+        for (int i = 0; i < selected; i++) {
+            if (!strcmp(requested, kVariants[i].TdokuSimdLevel())) {
+                selected = i;
+                break;
+            }
+        }
+    }
+    return kVariants[selected];
+}
+
+const SimdFunctions &Selected() {
+    static const SimdFunctions &selected = SelectVariant();
+    return selected;
+}
+
+// choose when the library is loaded rather than on the first solve. calls made earlier, from
+// other static initializers, still work since Selected() initializes on demand.
+const SimdFunctions &selected_at_load = Selected();
+
+} // namespace
+
+#define FORWARD(ret, name, params, args) \
+    extern "C" ret name params { \
+        return Selected().name args; \
+    }
+TDOKU_SIMD_FUNCTIONS(FORWARD)
+#undef FORWARD
@@ -0,0 +1,109 @@
+#ifndef TDOKU_SIMD_DISPATCH_H
+#define TDOKU_SIMD_DISPATCH_H
+
+// With the DISPATCH build option, solver_dpll_triad_simd.cc is compiled once per instruction set
+// (sse2, sse4_1, avx2, avx512) and simd_dispatch.cc forwards each public entry point to the best
+// variant the CPU supports. Each variant is compiled with TDOKU_SIMD_VARIANT set to its name,
+// which renames the functions it defines, e.g., TdokuSolveBatch becomes TdokuSolveBatch_avx2.
+// This header must be included before tdoku.h so the declarations are renamed as well.
+//
+// A function added to the API of solver_dpll_triad_simd.cc needs both a rename below and an
+// entry in TDOKU_SIMD_FUNCTIONS.
+
+#ifdef TDOKU_SIMD_VARIANT
+
+#define TDOKU_SIMD_CONCAT_(name, variant) name##_##variant
+#define TDOKU_SIMD_CONCAT(name, variant) TDOKU_SIMD_CONCAT_(name, variant)
+#define TDOKU_SIMD_NAME(name) TDOKU_SIMD_CONCAT(name, TDOKU_SIMD_VARIANT)
+
+#define TdokuSolverDpllTriadSimd TDOKU_SIMD_NAME(TdokuSolverDpllTriadSimd)
+#define TdokuSolveBatch TDOKU_SIMD_NAME(TdokuSolveBatch)
+#define TdokuSolveBatchParallel TDOKU_SIMD_NAME(TdokuSolveBatchParallel)
+#define TdokuEnumerate TDOKU_SIMD_NAME(TdokuEnumerate)
+#define TdokuCountParallel TDOKU_SIMD_NAME(TdokuCountParallel)
+#define TdokuEnumerateParallel TDOKU_SIMD_NAME(TdokuEnumerateParallel)
+#define TdokuSearchCreate TDOKU_SIMD_NAME(TdokuSearchCreate)
+#define TdokuSearchNext TDOKU_SIMD_NAME(TdokuSearchNext)
+#define TdokuSearchDestroy TDOKU_SIMD_NAME(TdokuSearchDestroy)
+#define TdokuContextCreate TDOKU_SIMD_NAME(TdokuContextCreate)
+#define TdokuContextDestroy TDOKU_SIMD_NAME(TdokuContextDestroy)
+#define TdokuContextUtil TDOKU_SIMD_NAME(TdokuContextUtil)
+#define TdokuContextSolverDpllTriadSimd TDOKU_SIMD_NAME(TdokuContextSolverDpllTriadSimd)
+#define TdokuContextEnumerate TDOKU_SIMD_NAME(TdokuContextEnumerate)
+#define TdokuContextConstrain TDOKU_SIMD_NAME(TdokuContextConstrain)
+#define TdokuContextMinimize TDOKU_SIMD_NAME(TdokuContextMinimize)
+#define TdokuConstrain TDOKU_SIMD_NAME(TdokuConstrain)
+#define TdokuMinimize TDOKU_SIMD_NAME(TdokuMinimize)
+#define TdokuContextConstrainMasked TDOKU_SIMD_NAME(TdokuContextConstrainMasked)
+#define TdokuContextMinimizeMasked TDOKU_SIMD_NAME(TdokuContextMinimizeMasked)
+#define TdokuConstrainMasked TDOKU_SIMD_NAME(TdokuConstrainMasked)
+#define TdokuMinimizeMasked TDOKU_SIMD_NAME(TdokuMinimizeMasked)
+#define TdokuRateFeatures TDOKU_SIMD_NAME(TdokuRateFeatures)
+#define TdokuSimdLevel TDOKU_SIMD_NAME(TdokuSimdLevel)
+#define TdokuStateBytesCopiedPerGuess TDOKU_SIMD_NAME(TdokuStateBytesCopiedPerGuess)
+
+#endif // TDOKU_SIMD_VARIANT
+
+// X(return type, name, (parameters), (arguments)) for each function a variant defines.
+#define TDOKU_SIMD_FUNCTIONS(X) \
+    X(size_t, TdokuSolverDpllTriadSimd, \
+      (const char *puzzle, size_t limit, uint32_t configuration, char *solution, \
+       size_t *num_guesses), \
+      (puzzle, limit, configuration, solution, num_guesses)) \
+    X(size_t, TdokuSolveBatch, \
+      (const char *puzzles, size_t count, size_t stride, size_t limit, char *solutions, \
+       uint32_t *counts, uint32_t *guesses), \
+      (puzzles, count, stride, limit, solutions, counts, guesses)) \
+    X(size_t, TdokuSolveBatchParallel, \
+      (const char *puzzles, size_t count, size_t stride, size_t limit, int num_threads, \
+       char *solutions, uint32_t *counts, uint32_t *guesses, double *wall_seconds), \
+      (puzzles, count, stride, limit, num_threads, solutions, counts, guesses, wall_seconds)) \
+    X(size_t, TdokuEnumerate, \
+      (const char *puzzle, size_t limit, void (*callback)(const char *, void *), \
+       void *callback_arg), \
+      (puzzle, limit, callback, callback_arg)) \
+    X(size_t, TdokuCountParallel, \
+      (const char *puzzle, size_t limit, int num_threads, size_t *num_guesses), \
+      (puzzle, limit, num_threads, num_guesses)) \
+    X(size_t, TdokuEnumerateParallel, \
+      (const char *puzzle, size_t limit, int num_threads, \
+       void (*callback)(const char *, void *), void *callback_arg), \
+      (puzzle, limit, num_threads, callback, callback_arg)) \
+    X(TdokuSearch *, TdokuSearchCreate, (const char *puzzle), (puzzle)) \
+    X(bool, TdokuSearchNext, (TdokuSearch *search, char *solution, size_t *num_guesses), \
+      (search, solution, num_guesses)) \
+    X(void, TdokuSearchDestroy, (TdokuSearch *search), (search)) \
+    X(TdokuContext *, TdokuContextCreate, (uint64_t random_seed), (random_seed)) \
+    X(void, TdokuContextDestroy, (TdokuContext *context), (context)) \
+    X(Util *, TdokuContextUtil, (TdokuContext *context), (context)) \
+    X(size_t, TdokuContextSolverDpllTriadSimd, \
+      (TdokuContext *context, const char *puzzle, size_t limit, uint32_t configuration, \
+       char *solution, size_t *num_guesses), \
+      (context, puzzle, limit, configuration, solution, num_guesses)) \
+    X(size_t, TdokuContextEnumerate, \
+      (TdokuContext *context, const char *puzzle, size_t limit, \
+       void (*callback)(const char *, void *), void *callback_arg), \
+      (context, puzzle, limit, callback, callback_arg)) \
+    X(bool, TdokuContextConstrain, (TdokuContext *context, bool pencilmark, char *puzzle), \
+      (context, pencilmark, puzzle)) \
+    X(bool, TdokuContextMinimize, \
+      (TdokuContext *context, bool pencilmark, bool monotonic, char *puzzle), \
+      (context, pencilmark, monotonic, puzzle)) \
+    X(bool, TdokuConstrain, (bool pencilmark, char *puzzle), (pencilmark, puzzle)) \
+    X(bool, TdokuMinimize, (bool pencilmark, bool monotonic, char *puzzle), \
+      (pencilmark, monotonic, puzzle)) \
+    X(bool, TdokuContextConstrainMasked, \
+      (TdokuContext *context, const char *mask, int symmetry, char *puzzle), \
+      (context, mask, symmetry, puzzle)) \
+    X(bool, TdokuContextMinimizeMasked, \
+      (TdokuContext *context, const char *mask, int symmetry, bool monotonic, char *puzzle), \
+      (context, mask, symmetry, monotonic, puzzle)) \
+    X(bool, TdokuConstrainMasked, (const char *mask, int symmetry, char *puzzle), \
+      (mask, symmetry, puzzle)) \
+    X(bool, TdokuMinimizeMasked, (const char *mask, int symmetry, bool monotonic, char *puzzle), \
+      (mask, symmetry, monotonic, puzzle)) \
+    X(size_t, TdokuRateFeatures, (const char *puzzle, float *features), (puzzle, features)) \
+    X(const char *, TdokuSimdLevel, (), ()) \
+    X(size_t, TdokuStateBytesCopiedPerGuess, (), ())
+
+#endif //TDOKU_SIMD_DISPATCH_H
@@ -52,6 +52,10 @@
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wreturn-type"
 
+// everything here has internal linkage. with the DISPATCH build option the solver is compiled
+// once per instruction set, and the variants must not share out-of-line copies of these.
+namespace {
+
 struct TwoBy64 {
     uint64_t x0;
     uint64_t x1;
@@ -64,8 +68,6 @@ struct FourBy64 {
     uint64_t x3;
 };
 
-namespace {
-
 struct Consts {
     __m128i popcount_mask4 = _mm_set1_epi16(0x0f);
     __m128i popcount_lookup = _mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
@@ -85,8 +87,6 @@ constexpr int OP_X_Y_andnot_Z_or = 0b10111010;
 constexpr int OP_X_Y_or_Z_or     = 0b11111110;
 constexpr int OP_X_Y_xor_Z_or    = 0b10111110;
 
-} // namespace
-
 struct Bitvec08x16 {
     __m128i vec;
 
@@ -847,6 +847,216 @@ struct Bitvec16x16 {
 
 #endif // __AVX2__
 
+#if(defined __AVX512BW__ && defined __AVX512VL__)
+
+// the following vectors hold two independent vectors of the types above, one per 128-bit lane
+// for Bitvec08x16x2 and one per pair of 128-bit lanes for Bitvec16x16x2, so that we can work on
+// two puzzles at once. operations act on each of the two separately, and tests report a bitmask
+// with bit i set for vector i. Bitvec16x16x2 keeps the low halves of both vectors in its low 256
+// bits and the high halves in its high 256 bits, so splitting into and combining from a pair of
+// Bitvec08x16x2 is as cheap as for Bitvec16x16.
+
+struct Bitvec08x16x2 {
+    __m256i vec;
+
+    Bitvec08x16x2() : vec{} {}
+
+    // non-explicit conversions intended
+    Bitvec08x16x2(const __m256i &m256i) noexcept : vec{m256i} {}
+
+    Bitvec08x16x2(const Bitvec08x16 &x0, const Bitvec08x16 &x1) noexcept :
+            vec{_mm256_set_m128i(x1.vec, x0.vec)} {}
+
+    static inline Bitvec08x16x2 Broadcast(const Bitvec08x16 &x) {
+        return _mm256_broadcastsi128_si256(x.vec);
+    }
+
+    static inline Bitvec08x16x2
+    X_Y_or_Z_or(const Bitvec08x16x2 &x, const Bitvec08x16x2 &y, const Bitvec08x16x2 &z) {
+        return _mm256_ternarylogic_epi32(x.vec, y.vec, z.vec, OP_X_Y_or_Z_or);
+    }
+
+    inline Bitvec08x16 Get(int which) const {
+        return which == 0 ? _mm256_castsi256_si128(vec) : _mm256_extracti128_si256(vec, 1);
+    }
+
+    inline uint32_t WhichNonZero() const {
+        uint32_t mask = _mm256_test_epi16_mask(vec, vec);
+        return (uint32_t) ((mask & 0xffu) != 0) | (uint32_t) ((mask & 0xff00u) != 0) << 1u;
+    }
+
+    inline Bitvec08x16x2 Shuffle(const Bitvec08x16x2 &control) const {
+        return _mm256_shuffle_epi8(vec, control.vec);
+    }
+
+    inline Bitvec08x16x2 RotateCols() const {
+        return _mm256_shuffle_epi32(vec, 0b01001110);
+    }
+
+    inline Bitvec08x16x2 operator|(const Bitvec08x16x2 &other) const {
+        return _mm256_or_si256(vec, other.vec);
+    }
+
+    inline void operator|=(const Bitvec08x16x2 &other) {
+        vec = (*this | other).vec;
+    }
+
+    inline Bitvec08x16x2 operator&(const Bitvec08x16x2 &other) const {
+        return _mm256_and_si256(vec, other.vec);
+    }
+
+    inline Bitvec08x16x2 and_not(const Bitvec08x16x2 &other) const {
+        return _mm256_andnot_si256(other.vec, vec);
+    };
+};
+
+struct Bitvec16x16x2 {
+    __m512i vec;
+
+    Bitvec16x16x2() noexcept : vec{} {}
+
+    // non-explicit conversions intended
+    Bitvec16x16x2(const __m512i &m512i) noexcept : vec{m512i} {}
+
+    Bitvec16x16x2(const Bitvec16x16x2 &other) noexcept = default;
+
+    Bitvec16x16x2(const Bitvec16x16 &x0, const Bitvec16x16 &x1) noexcept :
+            vec{_mm512_permutex2var_epi64(_mm512_castsi256_si512(x0.vec),
+                                          _mm512_setr_epi64(0, 1, 8, 9, 2, 3, 10, 11),
+                                          _mm512_castsi256_si512(x1.vec))} {}
+
+    Bitvec16x16x2(const Bitvec08x16x2 &lo, const Bitvec08x16x2 &hi) noexcept :
+            vec{_mm512_inserti64x4(_mm512_castsi256_si512(lo.vec), hi.vec, 1)} {}
+
+    static inline Bitvec16x16x2 All(uint16_t value) {
+        return _mm512_set1_epi16(value);
+    }
+
+    static inline Bitvec16x16x2 Broadcast(const Bitvec16x16 &x) {
+        return Bitvec16x16x2{x, x};
+    }
+
+    static inline Bitvec16x16x2
+    X_Y_and_Z_or(const Bitvec16x16x2 &x, const Bitvec16x16x2 &y, const Bitvec16x16x2 &z) {
+        return _mm512_ternarylogic_epi32(x.vec, y.vec, z.vec, OP_X_Y_and_Z_or);
+    }
+
+    static inline Bitvec16x16x2
+    X_Y_andnot_Z_or(const Bitvec16x16x2 &x, const Bitvec16x16x2 &y, const Bitvec16x16x2 &z) {
+        return _mm512_ternarylogic_epi32(x.vec, y.vec, z.vec, OP_X_Y_andnot_Z_or);
+    }
+
+    static inline Bitvec16x16x2
+    X_Y_or_Z_or(const Bitvec16x16x2 &x, const Bitvec16x16x2 &y, const Bitvec16x16x2 &z) {
+        return _mm512_ternarylogic_epi32(x.vec, y.vec, z.vec, OP_X_Y_or_Z_or);
+    }
+
+    static inline Bitvec16x16x2
+    X_Y_xor_Z_or(const Bitvec16x16x2 &x, const Bitvec16x16x2 &y, const Bitvec16x16x2 &z) {
+        return _mm512_ternarylogic_epi32(x.vec, y.vec, z.vec, OP_X_Y_xor_Z_or);
+    }
+
+    inline Bitvec16x16x2 &operator=(const Bitvec16x16x2 &other) = default;
+
+    inline Bitvec16x16 Get(int which) const {
+        __m512i index = which == 0 ? _mm512_setr_epi64(0, 1, 4, 5, 0, 1, 4, 5)
+                                   : _mm512_setr_epi64(2, 3, 6, 7, 2, 3, 6, 7);
+        return _mm512_castsi512_si256(_mm512_permutexvar_epi64(index, vec));
+    }
+
+    inline Bitvec08x16x2 GetLo() const {
+        return _mm512_castsi512_si256(vec);
+    }
+
+    inline Bitvec08x16x2 GetHi() const {
+        return _mm512_extracti64x4_epi64(vec, 1);
+    }
+
+    inline Bitvec16x16x2 WhichEqual(const Bitvec16x16x2 &other) const {
+        return _mm512_movm_epi16(_mm512_cmpeq_epi16_mask(vec, other.vec));
+    }
+
+    inline Bitvec16x16x2 WhichNonZero() const {
+        return _mm512_movm_epi16(_mm512_cmpgt_epi16_mask(vec, _mm512_setzero_si512()));
+    }
+
+    inline uint32_t WhichLessThan(const Bitvec16x16x2 &other) const {
+        uint32_t mask = _mm512_cmp_epi16_mask(vec, other.vec, _MM_CMPINT_LT);
+        return (uint32_t) ((mask & 0x00ff00ffu) != 0) | (uint32_t) ((mask & 0xff00ff00u) != 0) << 1u;
+    }
+
+    inline bool Intersects(const Bitvec16x16x2 &other) const {
+        return _mm512_test_epi64_mask(vec, other.vec) != 0;
+    }
+
+    inline bool SubsetOf(const Bitvec16x16x2 &other) const {
+        return _mm512_test_epi64_mask(_mm512_andnot_si512(other.vec, vec),
+                                      _mm512_andnot_si512(other.vec, vec)) == 0;
+    }
+
+    // counts the number of bits set among the 9 lowest order bits of each packed 16-bit integer
+    // subject to the assumption that the 7 high bits are zero. results are undefined if any of
+    // the 7 high bits are nonzero.
+    inline Bitvec16x16x2 Popcounts9() const {
+#ifdef __AVX512BITALG__
+        return _mm512_popcnt_epi16(vec);
+#else
+        __m512i lookup = _mm512_broadcast_i32x4(consts.popcount_lookup);
+        __m512i mask4 = _mm512_set1_epi16(0x0f);
+        __m512i sum_0_3 = _mm512_shuffle_epi8(lookup, _mm512_and_si512(vec, mask4));
+        __m512i sum_4_7 = _mm512_shuffle_epi8(lookup, _mm512_srli_epi16(vec, 4));
+        __m512i sum_0_7 = _mm512_add_epi16(sum_0_3, sum_4_7);
+        return _mm512_add_epi16(sum_0_7, _mm512_srli_epi16(vec, 8));
+#endif
+    }
+
+    inline Bitvec16x16x2 Shuffle(const Bitvec16x16x2 &control) const {
+        return _mm512_shuffle_epi8(vec, control.vec);
+    }
+
+    inline Bitvec16x16x2 RotateRows() const {
+#ifdef __AVX512VBMI2__
+        return _mm512_shldi_epi64(vec, vec, 16);
+#else
+        return _mm512_shuffle_epi8(vec, _mm512_broadcast_i32x4(consts.rotate_rows1));
+#endif
+    }
+
+    inline Bitvec16x16x2 RotateRows2() const {
+        return _mm512_shuffle_epi32(vec, (_MM_PERM_ENUM) 0b10110001);
+    }
+
+    inline Bitvec16x16x2 RotateCols() const {
+        return _mm512_permutexvar_epi64(_mm512_setr_epi64(1, 4, 3, 6, 5, 0, 7, 2), vec);
+    }
+
+    inline Bitvec16x16x2 RotateCols2() const {
+        return _mm512_shuffle_i64x2(vec, vec, 0b01001110);
+    }
+
+    inline Bitvec16x16x2 operator|(const Bitvec16x16x2 &other) const {
+        return _mm512_or_si512(vec, other.vec);
+    }
+
+    inline void operator|=(const Bitvec16x16x2 &other) {
+        vec = (*this | other).vec;
+    }
+
+    inline Bitvec16x16x2 operator&(const Bitvec16x16x2 &other) const {
+        return _mm512_and_si512(vec, other.vec);
+    }
+
+    inline void operator&=(const Bitvec16x16x2 &other) {
+        vec = (*this & other).vec;
+    }
+
+    inline Bitvec16x16x2 and_not(const Bitvec16x16x2 &other) const {
+        return _mm512_andnot_si512(other.vec, vec);
+    };
+};
+
+#endif // __AVX512BW__ && __AVX512VL__
+
 inline uint32_t WhichDots16(const char *x) {
     const __m128i dots = _mm_set1_epi8('.');
     const __m128i src = _mm_loadu_si128((const __m128i *) x);
@@ -875,6 +1085,8 @@ inline uint64_t WhichDots64(const char *x) {
     return (uint64_t) WhichDots32(x) | ((uint64_t) WhichDots32(x + 32) << 32u);
 }
 
+} // namespace
+
 #pragma GCC diagnostic pop
 
 #endif //TDOKU_SIMD_VECTORS_H
@@ -1,63 +1,299 @@
 #include "../include/tdoku.h"
+#include "context.h"
+#include "parallel.h"
+#include "rating.h"
+#include "rating_model.h"
 #include "util.h"
+#include <algorithm>
+#include <cmath>
 #include <cstring>
+#include <vector>
 
+namespace {
 
-double MeanLogGuesses(const char *puzzle, bool pencilmark, int solver, int num_evals) {
-    Util util{};
+// solves with the given context's solver, or with per-call solvers if context is null.
+size_t SolveImpl(TdokuContext *context, const char *input, size_t limit, int solver,
+                 char *solution, size_t *num_guesses) {
+    bool pencilmark = input[81] >= '.';
+    switch (solver)
+    {
+        case 0:
+            return (context ?
+                    TdokuContextSolverDpllTriadSimd(context, input, limit, 0, solution, num_guesses) :
+                    TdokuSolverDpllTriadSimd(input, limit, 0, solution, num_guesses)) > 0;
+        case 1:
+            return !pencilmark && TdokuSolverDpllTriadScc(input, limit, 0, solution, num_guesses) > 0;
+        case 2:
+            return TdokuSolverBasic(input, limit, 0, solution, num_guesses) > 0;
+    }
+
+    return 0;
+}
+
+size_t Solve(TdokuContext *context, const char* input, bool pencilmark, char* solution) {
+    char buffer[730];
+    size_t size = pencilmark? 729:81;
+    memcpy(buffer, input, size);
+    buffer[size] = '\0';
+    size_t guesses = 0;
+    // a single search with a limit of 2 keeps the first solution and checks its uniqueness.
+    return context ?
+           TdokuContextSolverDpllTriadSimd(context, buffer, 2, 2, solution, &guesses) :
+           TdokuSolverDpllTriadSimd(buffer, 2, 2, solution, &guesses);
+}
+
+// solves num_evals random permutations of the puzzle, passing log(guesses + 1) for each one
+// the solver supports to sample(log_guesses), and stops early once that returns false. returns
+// the number of permutations solved.
+template<typename SampleFn>
+int EvalPermutations(TdokuContext *context, Util &util, const char *puzzle, bool pencilmark,
+                     int solver, int num_evals, SampleFn sample) {
     char solution[81];
-    double sum_log_guesses = 0.0;
     char copy[792];
     memcpy(copy, puzzle, pencilmark? 792:82);
-    
-    int count = 0;
-    for (int j = 0; j < num_evals; j++) {
+
+    int j = 0;
+    while (j < num_evals) {
         util.PermuteSudoku(copy, pencilmark);
         size_t guesses = 0;
+        j++;
 
         // it may not solve, because some solvers doesn't support pencilmark
-        if(TdokuSolveImpl(copy, 1, solver, solution, &guesses)){
-            sum_log_guesses += log((double) guesses + 1);
-            count++;
+        if(SolveImpl(context, copy, 1, solver, solution, &guesses)){
+            if (!sample(log((double) guesses + 1))) break;
         }
     }
+    return j;
+}
+
+} // namespace
+
+double SumLogGuesses(TdokuContext *context, Util &util, const char *puzzle, bool pencilmark,
+                     int solver, int num_evals, int *count, double max_sum) {
+    double sum_log_guesses = 0.0;
+    *count = 0;
+    EvalPermutations(context, util, puzzle, pencilmark, solver, num_evals,
+                     [&](double log_guesses) {
+                         sum_log_guesses += log_guesses;
+                         (*count)++;
+                         return sum_log_guesses < max_sum;
+                     });
+    return sum_log_guesses;
+}
 
+double MeanLogGuesses(TdokuContext *context, Util &util, const char *puzzle, bool pencilmark,
+                      int solver, int num_evals) {
+    int count = 0;
+    double sum_log_guesses = SumLogGuesses(context, util, puzzle, pencilmark, solver, num_evals,
+                                           &count);
     return count == 0 ? 0.0 : sum_log_guesses / count;
 }
 
+int Rating(double mean_log_guesses) {
+    return (int)std::round(mean_log_guesses/log(9)*1000);
+}
+
+double MeanLogGuessesAbove(int rating) {
+    return (rating + 0.5) / 1000 * log(9);
+}
+
+namespace {
+
+// seeded ratings split the evaluations of a puzzle into chunks of a fixed size, each permuting
+// the puzzle with its own generator seeded from the seed, the puzzle and the chunk's index. so
+// a rating depends only on these and not on how the chunks are spread over threads.
+constexpr int kEvalsPerChunk = 16;
+
+// the number of puzzles rated at a time, which bounds the memory held for chunk results.
+constexpr size_t kPuzzlesPerRound = 1u << 16u;
+
+uint64_t Mix(uint64_t z) {
+    z = (z ^ (z >> 30u)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27u)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31u);
+}
+
+uint64_t ChunkSeed(uint64_t seed, const char *puzzle, size_t size, int chunk) {
+    uint64_t h = Mix(seed + 0x9e3779b97f4a7c15ull);
+    for (size_t i = 0; i < size; i++) h = Mix(h ^ (uint8_t) puzzle[i]);
+    return Mix(h + 0x9e3779b97f4a7c15ull * (uint64_t) (chunk + 1));
+}
+
+struct ChunkResult {
+    double sum_log_guesses = 0.0;
+    int count = 0;
+};
+
+void RateBatch(const char *puzzles, size_t count, size_t stride, bool pencilmark, int solver,
+               int num_evals, uint64_t random_seed, int num_threads, int *ratings) {
+    size_t size = pencilmark ? 729 : 81;
+    int num_chunks = std::max((num_evals + kEvalsPerChunk - 1) / kEvalsPerChunk, 1);
+    int num_workers = NumWorkers(num_threads);
+    std::vector<ChunkResult> results;
+
+    for (size_t first = 0; first < count; first += kPuzzlesPerRound) {
+        size_t num_puzzles = std::min(count - first, kPuzzlesPerRound);
+        size_t num_items = num_puzzles * num_chunks;
+        results.assign(num_items, ChunkResult());
+        int round_workers = (int) std::min((size_t) num_workers, num_items);
+
+        WorkStealingRanges ranges(num_items, round_workers);
+        RunWorkers(round_workers, [&](int w) {
+            TdokuContext *context = TdokuContextCreate(1);
+            if (!context) return; // the other workers steal this worker's share
+            Util util(1);
+            char puzzle[792];
+            size_t item;
+            while (ranges.Next(w, &item)) {
+                size_t p = first + item / num_chunks;
+                int chunk = (int) (item % num_chunks);
+                int evals = std::min(kEvalsPerChunk, num_evals - chunk * kEvalsPerChunk);
+                if (evals <= 0) continue;
+                // SumLogGuesses reads the input as a null terminated string.
+                memcpy(puzzle, puzzles + p * stride, size);
+                memset(puzzle + size, 0, sizeof(puzzle) - size);
+                util.RandomSeed(ChunkSeed(random_seed, puzzle, size, chunk));
+                ChunkResult &result = results[item];
+                result.sum_log_guesses = SumLogGuesses(context, util, puzzle, pencilmark, solver,
+                                                       evals, &result.count);
+            }
+            TdokuContextDestroy(context);
+        });
+
+        // combine chunks in order, so the sums don't depend on scheduling either.
+        for (size_t i = 0; i < num_puzzles; i++) {
+            double sum_log_guesses = 0.0;
+            int num_solved = 0;
+            for (int c = 0; c < num_chunks; c++) {
+                sum_log_guesses += results[i * num_chunks + c].sum_log_guesses;
+                num_solved += results[i * num_chunks + c].count;
+            }
+            ratings[first + i] = Rating(num_solved == 0 ? 0.0 : sum_log_guesses / num_solved);
+        }
+    }
+}
+
+// rates with evaluations drawn as in RateBatch, chunk by chunk, until the standard error of
+// the rating falls to the tolerance, after at least min_evals and at most max_evals of them.
+int RateAdaptive(const char *input, bool pencilmark, int solver, int min_evals, int max_evals,
+                 double tolerance, uint64_t random_seed, int *rating_low, int *rating_high,
+                 int *num_evals) {
+    size_t size = pencilmark ? 729 : 81;
+    char puzzle[792];
+    memcpy(puzzle, input, size);
+    memset(puzzle + size, 0, sizeof(puzzle) - size);
+    max_evals = std::max(max_evals, 1);
+    min_evals = std::min(std::max(min_evals, 1), max_evals);
+
+    // standard errors are tracked in units of rating.
+    const double scale = 1000.0 / log(9);
+    TdokuContext *context = TdokuContextCreate(1);
+    if (!context) {
+        if (rating_low) *rating_low = 0;
+        if (rating_high) *rating_high = 0;
+        if (num_evals) *num_evals = 0;
+        return 0;
+    }
+    Util util(1);
+    double sum = 0.0, sum_squares = 0.0, standard_error = 0.0;
+    int num_solved = 0, evals = 0;
+    bool done = false;
+    for (int chunk = 0; !done && evals < max_evals; chunk++) {
+        util.RandomSeed(ChunkSeed(random_seed, puzzle, size, chunk));
+        int chunk_evals = std::min(kEvalsPerChunk, max_evals - evals);
+        evals += EvalPermutations(context, util, puzzle, pencilmark, solver, chunk_evals,
+                                  [&](double log_guesses) {
+            double x = log_guesses * scale;
+            sum += x;
+            sum_squares += x * x;
+            num_solved++;
+            // a few permutations can solve a puzzle with the same number of guesses even when
+            // others need more, so the variance counts one more evaluation deviating from the
+            // mean by the mean itself. puzzles needing no guesses still stop after min_evals.
+            double mean = sum / num_solved;
+            double variance = (std::max(sum_squares - num_solved * mean * mean, 0.0) +
+                               mean * mean) / num_solved;
+            standard_error = sqrt(variance / num_solved);
+            done = num_solved >= std::max(min_evals, 2) && standard_error <= tolerance;
+            return !done;
+        });
+    }
+    TdokuContextDestroy(context);
+
+    // a normal 95% confidence interval.
+    double mean = num_solved ? sum / num_solved : 0.0;
+    if (rating_low) *rating_low = (int) std::round(mean - 1.96 * standard_error);
+    if (rating_high) *rating_high = (int) std::round(mean + 1.96 * standard_error);
+    if (num_evals) *num_evals = evals;
+    return (int) std::round(mean);
+}
+
+} // namespace
+
+extern "C"
+int TdokuRateAdaptive(const char *input, bool pencilmark, int solver, int min_evals,
+                      int max_evals, double tolerance, uint64_t random_seed, int *rating_low,
+                      int *rating_high, int *num_evals){
+    return RateAdaptive(input, pencilmark, solver, min_evals, max_evals, tolerance, random_seed,
+                        rating_low, rating_high, num_evals);
+}
+
+extern "C"
+int TdokuRateEstimate(const char *input){
+    float features[TDOKU_NUM_RATE_FEATURES];
+    if (!TdokuRateFeatures(input, features)) return 0;
+    float estimate = 0.0f;
+    for (int i = 0; i < TDOKU_NUM_RATE_FEATURES; i++) estimate += kRatingModel[i] * features[i];
+    return estimate > 0.0f ? (int) std::round(estimate) : 0;
+}
+
+extern "C"
+int TdokuRateSeeded(const char *input, bool pencilmark, int solver, int num_evals,
+                    uint64_t random_seed, int num_threads){
+    int rating = 0;
+    RateBatch(input, 1, 0, pencilmark, solver, num_evals, random_seed, num_threads, &rating);
+    return rating;
+}
+
+extern "C"
+void TdokuRateBatch(const char *puzzles, size_t count, size_t stride, bool pencilmark,
+                    int solver, int num_evals, uint64_t random_seed, int num_threads,
+                    int *ratings){
+    RateBatch(puzzles, count, stride, pencilmark, solver, num_evals, random_seed, num_threads,
+              ratings);
+}
+
 extern "C"
 int TdokuRate(const char *input, bool pencilmark, int solver, int num_evals){
-    double l = MeanLogGuesses(input, pencilmark, solver, num_evals);
-    return (int)std::round(l/log(9)*1000);
+    Util util{};
+    return Rating(MeanLogGuesses(nullptr, util, input, pencilmark, solver, num_evals));
 }
 
+extern "C"
+int TdokuContextRate(TdokuContext *context, const char *input, bool pencilmark, int solver,
+                     int num_evals){
+    Util &util = *TdokuContextUtil(context);
+    return Rating(MeanLogGuesses(context, util, input, pencilmark, solver, num_evals));
+}
 
 extern "C"
 size_t TdokuSolveImpl(const char *input, size_t limit, int solver, char *solution, size_t *num_guesses){
-    bool pencilmark = input[81] >= '.';
-    switch (solver)
-    {
-        case 0:
-            return TdokuSolverDpllTriadSimd(input, limit, 0, solution, num_guesses) > 0;
-        case 1:
-            return !pencilmark && TdokuSolverDpllTriadScc(input, limit, 0, solution, num_guesses) > 0;
-        case 2:
-            return TdokuSolverBasic(input, limit, 0, solution, num_guesses) > 0;
-    }
+    return SolveImpl(nullptr, input, limit, solver, solution, num_guesses);
+}
 
-    return 0;
+extern "C"
+size_t TdokuContextSolveImpl(TdokuContext *context, const char *input, size_t limit, int solver,
+                             char *solution, size_t *num_guesses){
+    return SolveImpl(context, input, limit, solver, solution, num_guesses);
 }
 
 extern "C"
 size_t TdokuSolve(const char* input, bool pencilmark, char* solution){
-    char buffer[730];
-    size_t size = pencilmark? 729:81;
-    memcpy(buffer, input, size);
-    buffer[size] = '\0';
-    size_t guesses = 0;
-    size_t count = TdokuSolveImpl(buffer, 1, 0, solution, &guesses);
-    if(count > 0){
-        count = TdokuSolveImpl(buffer, 2, 0, solution, &guesses);
-    }
-    return count;
+    return Solve(nullptr, input, pencilmark, solution);
+}
+
+extern "C"
+size_t TdokuContextSolve(TdokuContext *context, const char* input, bool pencilmark,
+                         char* solution){
+    return Solve(context, input, pencilmark, solution);
 }
@@ -137,7 +137,7 @@ struct SolverBasic {
 extern "C"
 size_t TdokuSolverBasic(const char *input, size_t limit, uint32_t configuration,
                         char *solution, size_t *num_guesses) {
-    static SolverBasic solver;
+    thread_local SolverBasic solver;
     if (solver.Initialize(input, limit, configuration, solution)) {
         solver.SatisfyGivenPartialAssignment(0, solution);
         *num_guesses = solver.num_guesses_;
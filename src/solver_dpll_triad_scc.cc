@@ -60,96 +60,56 @@ struct State {
     State(const State &prior_state) = default;
 };
 
-struct SolverDpllTriadScc {
-    // this mapping from ClauseId to LiteralId will not change after setup.
+// literals are numbered so positive and negative literals for the same variable are adjacent.
+// a positive literal has id % 2 == 0.
+inline LiteralId Not(LiteralId literal) {
+    return literal ^ 1u;
+}
+
+// returns a *positive* literal id reflecting the proposition that the given element of the
+// given box has the given value. boxes and values are numbered 0-8. elements are numbered
+// based on a 4x4 grid, with the upper-left 3x3 subgrid being the actual 9 cells of the box
+// and the 3x1 and 1x3 extra column and row being horizontal and vertical triads. The last
+// element of the 4x4 grid is unused, but remains for indexing convenience.
+inline LiteralId Literal(int box, int elem, int value) {
+    // this order strikes the best balance of locality and avoiding division in ValidLiteral
+    return (uint32_t)(2 * (elem + 16 * (value + 9 * box)));
+}
+
+// return true if the literal is in use (vs. in the filler space at the end of each box).
+inline bool ValidLiteral(LiteralId literal) {
+    return ((literal % 32u) & 0x1eu) != 0x1eu;
+}
+
+// the clauses and initial implications expressing the rules of Sudoku. these are the same for
+// every puzzle and every solver, so they're built once and shared read-only by all solvers.
+struct Constraints {
+    // mapping from ClauseId to LiteralId.
     vector<vector<LiteralId>> clauses_to_literals_{};
-    // this mapping from LiteralId to ClauseId will not change after setup.
+    // mapping from LiteralId to ClauseId.
     array<vector<ClauseId>, kNumLiterals> literals_to_clauses_{};
-    // initial setup will populate these vectors with implications that are part of Sudoku
-    // rules. during BCP and DPLL search we'll discover new implications and push and pop them
-    // from these vectors. we don't copy these vectors as part of the state. instead we just
-    // copy implication counts that determine the logical size of these lists.
+    // the implications that are part of Sudoku rules. each solver starts its own implication
+    // lists from a copy of these.
     array<vector<LiteralId>, kNumLiterals> literals_to_implications_{};
     // a list of clauses expressing that each cell must have a value. if we're not using SCCs
     // for choosing literals to branch then it suffices to pick among these clauses and then
     // pick a literal from the chosen clause.
     vector<ClauseId> positive_cell_clauses_{};
-    // initial state with the correct implication counts. we'll clone this when we begin
-    // solving each new puzzle, but this will not change after setup.
+    // initial state with the correct implication counts. solvers clone this when they begin
+    // solving each new puzzle.
     State initial_state_{};
-    // whether to use strongly connected component size as a heuristic for variable selection.
-    bool scc_heuristic_ = true;
-    // whether to apply inferences reached during strongly connected component evaluation.
-    bool scc_inference_ = true;
-    // stop after finding this many solutions.
-    size_t limit_ = 1;
 
-    size_t num_guesses_ = 0;
-    size_t num_solutions_ = 0;
-    State result_{};
-
-    SolverDpllTriadScc() {
+    Constraints() {
         SetupConstraints();
     }
 
-    static void Display(State *state) {
-        string div1 = " +=====+=====+=====+=====+=====+=====+=====+=====+=====+=====+=====+=====+";
-        string div2 = " +-----+-----+-----+-----+-----+-----+-----+-----+-----+-----+-----+-----+";
-        for (int i = 0; i < 12; i++) {
-            cout << (((i % 4) == 0) ? div1 : div2) << endl;
-            for (int vi = 0; vi < 3; vi++) {
-                for (int j = 0; j < 12; j++) {
-                    cout << " | ";
-                    for (int vj = 0; vj < 3; vj++) {
-                        int box = i / 4 * 3 + j / 4;
-                        int elm = (i % 4) * 4 + (j % 4);
-                        if (state->asserted[Not(Literal(box, elm, vi * 3 + vj))]) {
-                            cout << " ";
-                        } else {
-                            cout << vi * 3 + vj + 1;
-                        }
-                    }
-                }
-                cout << " |" << endl;
-            }
-        }
-        cout << div1 << endl << endl;
-    }
-
     ///////////////////////////////////////////////
     // constraint setup
     ///////////////////////////////////////////////
 
-    // literals are numbered so positive and negative literals for the same variable are adjacent.
-    // a positive literal has id % 2 == 0.
-    static inline LiteralId Not(LiteralId literal) {
-        return literal ^ 1u;
-    }
-
-    // returns a *positive* literal id reflecting the proposition that the given element of the
-    // given box has the given value. boxes and values are numbered 0-8. elements are numbered
-    // based on a 4x4 grid, with the upper-left 3x3 subgrid being the actual 9 cells of the box
-    // and the 3x1 and 1x3 extra column and row being horizontal and vertical triads. The last
-    // element of the 4x4 grid is unused, but remains for indexing convenience.
-    static LiteralId Literal(int box, int elem, int value) {
-        // this order strikes the best balance of locality and avoiding division in ValidLiteral
-        return (uint32_t)(2 * (elem + 16 * (value + 9 * box)));
-    }
-
-    // return true if the literal is in use (vs. in the filler space at the end of each box).
-    static bool ValidLiteral(LiteralId literal) {
-        return ((literal % 32u) & 0x1eu) != 0x1eu;
-    }
-
-    inline void AddImplication(LiteralId from, LiteralId to, State *state) {
-        auto &implications = literals_to_implications_[from];
-        auto &current_size = state->implication_counts[from];
-        if (implications.size() == current_size) {
-            implications.push_back(to);
-        } else {
-            implications[current_size] = to;
-        }
-        current_size++;
+    inline void AddImplication(LiteralId from, LiteralId to) {
+        literals_to_implications_[from].push_back(to);
+        initial_state_.implication_counts[from]++;
     }
 
     inline void AddClauseWithMinimum(const vector<LiteralId> &literals, int min) {
@@ -169,8 +129,8 @@ struct SolverDpllTriadScc {
         if (n == 1) {
             for (size_t i = 0; i < literals.size() - 1; i++) {
                 for (size_t j = i + 1; j < literals.size(); j++) {
-                    AddImplication(literals[i], Not(literals[j]), &initial_state_);
-                    AddImplication(literals[j], Not(literals[i]), &initial_state_);
+                    AddImplication(literals[i], Not(literals[j]));
+                    AddImplication(literals[j], Not(literals[i]));
                 }
             }
         } else {
@@ -230,6 +190,66 @@ struct SolverDpllTriadScc {
             }
         }
     }
+};
+
+const Constraints &SharedConstraints() {
+    static const Constraints constraints{};
+    return constraints;
+}
+
+struct SolverDpllTriadScc {
+    const Constraints &constraints_ = SharedConstraints();
+    // during BCP and DPLL search we'll discover new implications and push and pop them from
+    // these vectors, which start as a copy of the shared ones. we don't copy these vectors as
+    // part of the state. instead we just copy implication counts that determine the logical
+    // size of these lists.
+    array<vector<LiteralId>, kNumLiterals> literals_to_implications_{
+            constraints_.literals_to_implications_};
+    // whether to use strongly connected component size as a heuristic for variable selection.
+    bool scc_heuristic_ = true;
+    // whether to apply inferences reached during strongly connected component evaluation.
+    bool scc_inference_ = true;
+    // stop after finding this many solutions.
+    size_t limit_ = 1;
+
+    size_t num_guesses_ = 0;
+    size_t num_solutions_ = 0;
+    State result_{};
+
+    static void Display(State *state) {
+        string div1 = " +=====+=====+=====+=====+=====+=====+=====+=====+=====+=====+=====+=====+";
+        string div2 = " +-----+-----+-----+-----+-----+-----+-----+-----+-----+-----+-----+-----+";
+        for (int i = 0; i < 12; i++) {
+            cout << (((i % 4) == 0) ? div1 : div2) << endl;
+            for (int vi = 0; vi < 3; vi++) {
+                for (int j = 0; j < 12; j++) {
+                    cout << " | ";
+                    for (int vj = 0; vj < 3; vj++) {
+                        int box = i / 4 * 3 + j / 4;
+                        int elm = (i % 4) * 4 + (j % 4);
+                        if (state->asserted[Not(Literal(box, elm, vi * 3 + vj))]) {
+                            cout << " ";
+                        } else {
+                            cout << vi * 3 + vj + 1;
+                        }
+                    }
+                }
+                cout << " |" << endl;
+            }
+        }
+        cout << div1 << endl << endl;
+    }
+
+    inline void AddImplication(LiteralId from, LiteralId to, State *state) {
+        auto &implications = literals_to_implications_[from];
+        auto &current_size = state->implication_counts[from];
+        if (implications.size() == current_size) {
+            implications.push_back(to);
+        } else {
+            implications[current_size] = to;
+        }
+        current_size++;
+    }
 
     ///////////////////////////////////////////////
     // boolean constraint propagation
@@ -240,8 +260,8 @@ struct SolverDpllTriadScc {
     // we have a clause with a minimum of N that's now down to N+1 literals. if any of its
     // remaining literals are eliminated then the rest are implied.
     void AddBinaryImplicationsAmongNonEliminated(ClauseId clause_id, State *state) {
-        const auto &literals = clauses_to_literals_[clause_id];
-        int expect = literals.size() - initial_state_.clause_free_literals[clause_id];
+        const auto &literals = constraints_.clauses_to_literals_[clause_id];
+        int expect = literals.size() - constraints_.initial_state_.clause_free_literals[clause_id];
         // optimize for the common case where the clause has a minimum of 1
         if (expect == 2) {
             LiteralId first = kNumLiterals;
@@ -285,7 +305,7 @@ struct SolverDpllTriadScc {
 
         // decrement free literal counts for clauses containing the negation to reflect that these
         // literals are eliminated; update implication lists if this produces new binary clauses.
-        for (auto clause_id : literals_to_clauses_[Not(literal)]) {
+        for (auto clause_id : constraints_.literals_to_clauses_[Not(literal)]) {
             if (--state->clause_free_literals[clause_id] == 0) {
                 AddBinaryImplicationsAmongNonEliminated(clause_id, state);
             }
@@ -427,14 +447,14 @@ struct SolverDpllTriadScc {
     // such literal. assumes that the puzzle is *not* already solved.
     LiteralId ChooseLiteralToBranchByClause(State *state) {
         int min_free = INT8_MAX, which_clause = 0;
-        for (ClauseId clause_id : positive_cell_clauses_) {
+        for (ClauseId clause_id : constraints_.positive_cell_clauses_) {
             int num_free = state->clause_free_literals[clause_id];
             if (num_free < min_free) {
                 min_free = num_free;
                 which_clause = clause_id;
             }
         }
-        for (LiteralId literal : clauses_to_literals_[which_clause]) {
+        for (LiteralId literal : constraints_.clauses_to_literals_[which_clause]) {
             if (!state->asserted[Not(literal)]) {
                 return literal;
             }
@@ -511,8 +531,8 @@ struct SolverDpllTriadScc {
         num_solutions_ = 0;
         *num_guesses = num_guesses_ = 0;
 
-        result_ = initial_state_;
-        State state = initial_state_;
+        result_ = constraints_.initial_state_;
+        State state = constraints_.initial_state_;
 
         if (!InitializePuzzle(input, pencilmark, &state)) {
             return 0;
@@ -539,6 +559,6 @@ struct SolverDpllTriadScc {
 extern "C"
 size_t TdokuSolverDpllTriadScc(const char *input, size_t limit, uint32_t configuration,
                                char *solution, size_t *num_guesses) {
-    static SolverDpllTriadScc solver;
+    thread_local SolverDpllTriadScc solver;
     return solver.SolveSudoku(input, limit, configuration, solution, num_guesses);
 }
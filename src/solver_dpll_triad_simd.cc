@@ -1,9 +1,24 @@
+// first, so that variant builds rename the declarations in tdoku.h and context.h too.
+#include "simd_dispatch.h"
+
+#include "../include/tdoku.h"
 #include "bitutil.h"
+#include "context.h"
+#include "parallel.h"
 #include "simd_vectors.h"
+#include "symmetry.h"
 #include "util.h"
 
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
 #include <cstring>
+#include <memory>
+#include <mutex>
 
 #define LIKELY(x) __builtin_expect(!!(x),1)
 
@@ -68,6 +83,10 @@ struct Box {
 // is higher, and the benefit is lower (the benefit for Bands chiefly arises from the
 // way we do puzzle initialization).
 //
+// The solver reaches bands only through the accessors of State, so the layout below can be
+// swapped for the compact one by defining TDOKU_COMPACT_STATE (the COMPACT_STATE build option).
+#ifndef TDOKU_COMPACT_STATE
+
 struct Band {
     Cells08 configurations{kAll, kAll, kAll, kAll, kAll, kAll, 0, 0};
     Cells08 eliminations{};
@@ -76,8 +95,84 @@ struct Band {
 struct State {
     Band bands[2][3]{};
     Box boxen[9]{};
+
+    Cells08 Configurations(int vertical, int band_idx) const {
+        return bands[vertical][band_idx].configurations;
+    }
+
+    void SetConfigurations(int vertical, int band_idx, const Cells08 &configurations) {
+        bands[vertical][band_idx].configurations = configurations;
+    }
+
+    Cells08 &Eliminations(int vertical, int band_idx) {
+        return bands[vertical][band_idx].eliminations;
+    }
+
+    const Cells08 &Eliminations(int vertical, int band_idx) const {
+        return bands[vertical][band_idx].eliminations;
+    }
+
+    // copies a state to branch from it.
+    void CopyForGuess(const State &other) {
+        *this = other;
+    }
 };
 
+#else
+
+// The compact layout is ordered so that a guess copies only a prefix of the State, leaving out
+// the band eliminations. Eliminations only accumulate, and once a propagation succeeds all of
+// them have been applied to the configurations, so a state we branch from has none pending and
+// its copy can start over from zero. This cuts the bytes copied per guess from 480 to 384.
+//
+// Packing the 6 live lanes of the band configurations would save another 24 bytes, but the
+// masked loads and split stores this takes in BandEliminate cost more than the copy saves.
+struct State {
+    Box boxen[9]{};
+    Cells08 configurations[2][3]{};
+    Cells08 eliminations[2][3]{};
+
+    State() {
+        for (auto &band_configurations : configurations) {
+            for (auto &band : band_configurations) {
+                band = Cells08{kAll, kAll, kAll, kAll, kAll, kAll, 0, 0};
+            }
+        }
+    }
+
+    Cells08 Configurations(int vertical, int band_idx) const {
+        return configurations[vertical][band_idx];
+    }
+
+    void SetConfigurations(int vertical, int band_idx, const Cells08 &band_configurations) {
+        configurations[vertical][band_idx] = band_configurations;
+    }
+
+    Cells08 &Eliminations(int vertical, int band_idx) {
+        return eliminations[vertical][band_idx];
+    }
+
+    const Cells08 &Eliminations(int vertical, int band_idx) const {
+        return eliminations[vertical][band_idx];
+    }
+
+    // copies a state to branch from it.
+    void CopyForGuess(const State &other) {
+        memcpy((void *) this, &other, offsetof(State, eliminations));
+        for (auto &band_eliminations : eliminations) {
+            for (auto &band : band_eliminations) band = Cells08{};
+        }
+    }
+};
+
+#endif // TDOKU_COMPACT_STATE
+
+#ifndef TDOKU_COMPACT_STATE
+constexpr size_t kStateBytesCopiedPerGuess = sizeof(State);
+#else
+constexpr size_t kStateBytesCopiedPerGuess = offsetof(State, eliminations);
+#endif
+
 struct BoxIndexing {
     uint8_t box_i;
     uint8_t box_j;
@@ -262,14 +357,44 @@ struct Tables {
 
 const Tables tables{};
 
+// the levels of the iterative search. the first level holds the state we started guessing
+// from, and each level below holds a copy of the one above with the first configuration of a
+// band and value assigned, which is negated in the level above once the search below is done.
+// a band and value with an assigned configuration never branch again further down, so there
+// are at most 6 bands x 9 values levels below the first. a search in reverse order instead
+// goes down with the negation, removing one of the at most 6 configurations of a band and
+// value, so it needs up to 6 bands x 9 values x 5 levels. either way the stack lives on the
+// heap, which keeps deep searches off the call stack of the thread.
+template<int kMaxDepth>
+struct alignas(64) SearchStack {
+    State states[kMaxDepth + 1];
+    Cells08 negations[kMaxDepth];
+    uint8_t bands[kMaxDepth];
+};
+
+struct FreeDeleter {
+    void operator()(void *memory) const { free(memory); }
+};
+
+// solution_mode 0 only counts solutions, 1 keeps the limit-th solution found, 2 reports every
+// solution to a callback, and 3 keeps the first solution found while counting up to the limit.
+// 4 keeps the limit-th solution like 1, but visits the two subtrees of every guess in the
+// opposite order, which finds the solutions in exactly the reverse of the usual order.
 template<int solution_mode>
 struct SolverDpllTriadSimd {
+    static constexpr bool kReverse = solution_mode == 4;
+    using SearchStack = ::SearchStack<kReverse ? 6 * 9 * 5 : 6 * 9>;
+
     State solution_{};
     size_t limit_ = 1;
     size_t num_solutions_ = 0;
     size_t num_guesses_ = 0;
     void (*callback_)(const char *, void *) = nullptr;
     void *callback_arg_ = nullptr;
+    // allocated on the first guess and kept for later searches.
+    unique_ptr<SearchStack, FreeDeleter> stack_;
+    // the level of the last solution found if the search stopped at its limit, otherwise -1.
+    int suspended_depth_ = -1;
 
     // restrict the cell, minirow, and minicol clauses of the box to contain only the given
     // cell and triad candidates.
@@ -283,8 +408,8 @@ struct SolverDpllTriadSimd {
         int box_i = tables.div3[box_idx];
         int box_j = tables.mod3[box_idx];
 
-        Band &h_band = state.bands[0][box_i];
-        Band &v_band = state.bands[1][box_j];
+        Cells08 &h_band_eliminations = state.Eliminations(0, box_i);
+        Cells08 &v_band_eliminations = state.Eliminations(1, box_j);
         do {
             // apply eliminations and check that no cell clause now violates its minimum
             box.cells = box.cells.and_not(eliminating);
@@ -303,7 +428,7 @@ struct SolverDpllTriadSimd {
 
             // construct elimination messages for this box and for our band peers
             AssertionsToEliminations(all_assertions, box_i, box_j, eliminating,
-                                     h_band.eliminations, v_band.eliminations);
+                                     h_band_eliminations, v_band_eliminations);
 
         } while (eliminating.Intersects(box.cells));
 
@@ -410,13 +535,14 @@ struct SolverDpllTriadSimd {
 
     template<int vertical>
     static bool BandEliminate(State &state, int band_idx, int from_peer = 0) {
-        Band &band = state.bands[vertical][band_idx];
-        if (LIKELY(!band.configurations.Intersects(band.eliminations))) return true;
+        const Cells08 &eliminations = state.Eliminations(vertical, band_idx);
+        Cells08 configurations = state.Configurations(vertical, band_idx);
+        if (LIKELY(!configurations.Intersects(eliminations))) return true;
         // after eliminating we might check that every value is still consistent with some
         // configuration, but the check is a net loss.
-        band.configurations = band.configurations.and_not(band.eliminations);
+        configurations = configurations.and_not(eliminations);
 
-        Cells16 triads = ConfigurationsToPositiveTriads(band.configurations);
+        Cells16 triads = ConfigurationsToPositiveTriads(configurations);
         // we might check here that every cell (corresponding to a minirow or minicol) still has
         // at least three triad candidates, but the check is a net loss.
         Cells16 counts = triads.Popcounts9();
@@ -426,15 +552,16 @@ struct SolverDpllTriadSimd {
         Cells16 asserting = triads & counts.WhichEqual(Cells16::All(3));
         Cells08 lo = asserting.GetLo();
         Cells08 hi = asserting.GetHi();
-        band.configurations = band.configurations.and_not(Cells08::X_Y_or_Z_or(
+        configurations = configurations.and_not(Cells08::X_Y_or_Z_or(
                 lo.RotateCols().Shuffle(tables.triads_shift1_to_config_elims[0]),
                 lo.RotateCols().Shuffle(tables.triads_shift2_to_config_elims[0]),
                 lo.Shuffle(tables.triads_shift1_to_config_elims[1])));
-        band.configurations = band.configurations.and_not(Cells08::X_Y_or_Z_or(
+        configurations = configurations.and_not(Cells08::X_Y_or_Z_or(
                 lo.Shuffle(tables.triads_shift2_to_config_elims[1]),
                 hi.RotateCols().Shuffle(tables.triads_shift1_to_config_elims[2]),
                 hi.RotateCols().Shuffle(tables.triads_shift2_to_config_elims[2])));
-        triads = ConfigurationsToPositiveTriads(band.configurations);
+        state.SetConfigurations(vertical, band_idx, configurations);
+        triads = ConfigurationsToPositiveTriads(configurations);
 
         // convert positive triads to box restriction messages and send to the three box peers.
         // send these messages in order so that we return to the inbound peer last.
@@ -478,12 +605,12 @@ struct SolverDpllTriadSimd {
         // a minimum unfixed band will have 0 <= count-10 <= 44. if all bands are fixed then the
         // minimum after subtracting 10 and interpreting as a uint will be 0xfffa.
         uint32_t config_minpos = Bitvec08x16{
-                (uint16_t)state.bands[0][0].configurations.Popcount(),
-                (uint16_t)state.bands[0][1].configurations.Popcount(),
-                (uint16_t)state.bands[0][2].configurations.Popcount(),
-                (uint16_t)state.bands[1][0].configurations.Popcount(),
-                (uint16_t)state.bands[1][1].configurations.Popcount(),
-                (uint16_t)state.bands[1][2].configurations.Popcount(),
+                (uint16_t)state.Configurations(0, 0).Popcount(),
+                (uint16_t)state.Configurations(0, 1).Popcount(),
+                (uint16_t)state.Configurations(0, 2).Popcount(),
+                (uint16_t)state.Configurations(1, 0).Popcount(),
+                (uint16_t)state.Configurations(1, 1).Popcount(),
+                (uint16_t)state.Configurations(1, 2).Popcount(),
                 (uint16_t)0xffff,
                 (uint16_t)0xffff
         }.MinPosGreaterThanOrEqual(10);
@@ -495,8 +622,8 @@ struct SolverDpllTriadSimd {
         // net negative for Pencilmark Sudoku.
         if ((config_minpos & 0xff00u) == 0) {
             best_band = config_minpos >> 16u;
-            const auto &configurations =
-                    state.bands[tables.div3[best_band]][tables.mod3[best_band]].configurations;
+            Cells08 configurations =
+                    state.Configurations(tables.div3[best_band], tables.mod3[best_band]);
             Cells08 one = configurations;
             Cells08 shuffle_rotate = Cells08{shuf01, shuf02, shuf03, shuf04, shuf05, shuf00, 0xffff, 0xffff};
             Cells08 rotated = one.Shuffle(shuffle_rotate); // 1
@@ -536,46 +663,157 @@ struct SolverDpllTriadSimd {
         return {best_band, Cells08::All(0)};
     }
 
-    template<int vertical>
-    void BranchOnBandAndValue(int band_idx, const Cells08 &value_mask, State &state) {
-        Band &band = state.bands[vertical][band_idx];
-        // we enter with two or more possible configurations for this value
-        Cells08 value_configurations = band.configurations & value_mask;
-        // assign the first configuration by eliminating the others
-        num_guesses_++;
-        State state_copy = state;
-        Cells08 assignment_elims = value_configurations.ClearLowBit();
-        state_copy.bands[vertical][band_idx].eliminations |= assignment_elims;
-        if (BandEliminate<vertical>(state_copy, band_idx)) {
-            CountSolutionsConsistentWithPartialAssignment(state_copy);
-            if (num_solutions_ == limit_) return;
-        }
-        // now negate the first configuration
-        Cells08 negation_elims = value_configurations ^ assignment_elims;
-        state.bands[vertical][band_idx].eliminations |= negation_elims;
-        if (BandEliminate<vertical>(state, band_idx)) {
-            CountSolutionsConsistentWithPartialAssignment(state);
-        }
+    // counts the solution in the given state. returns whether this reached the limit.
+    bool CountSolution(const State &state) {
+        num_solutions_++;
+        if ((solution_mode == 1 || kReverse) && num_solutions_ == limit_) solution_ = state;
+        if (solution_mode == 3 && num_solutions_ == 1) solution_ = state;
+        if (solution_mode == 2) ReportSolution(state);
+        return num_solutions_ == limit_;
     }
 
     // do not call this twice on the same state. for efficiency this count may modify the
     // given state instead of making copies. if called with limit > 1 this can leave the state
     // changed in a way that makes subsequent calls return different results.
     void CountSolutionsConsistentWithPartialAssignment(State &state) {
+        suspended_depth_ = -1;
         auto band_and_value = ChooseBandAndValueToBranch(state);
         if (band_and_value.first == NONE) {
-            num_solutions_++;
-            if (solution_mode == 1 && num_solutions_ == limit_) solution_ = state;
-            if (solution_mode == 2) ReportSolution(state);
-        } else {
-            if (band_and_value.first < 3) {
-                BranchOnBandAndValue<0>(
-                        tables.mod3[band_and_value.first], band_and_value.second, state);
+            CountSolution(state);
+            return;
+        }
+        // we'll need to guess, so continue from the bottom of the search stack.
+        if (!ReserveStack()) {
+            SearchRecursively(state);
+            return;
+        }
+        stack_->states[0] = state;
+        Search(0, band_and_value);
+    }
+
+    // allocates the search stack unless we have one already. returns false if that fails.
+    bool ReserveStack() {
+        if (!stack_) {
+            stack_.reset((SearchStack *) aligned_alloc(alignof(SearchStack), sizeof(SearchStack)));
+        }
+        return (bool) stack_;
+    }
+
+    // the same search as Search, for when the search stack can't be allocated, with the levels
+    // on the call stack instead. it can't be resumed. returns whether it reached the limit.
+    bool SearchRecursively(const State &state) {
+        State children[2];
+        int num_children = Branch(state, children);
+        if (num_children < 0) return CountSolution(state);
+        num_guesses_++;
+        for (int i = 0; i < num_children; i++) {
+            if (SearchRecursively(children[kReverse ? num_children - 1 - i : i])) return true;
+        }
+        return false;
+    }
+
+    // continues a search that stopped at its limit, with the limit raised to the given one.
+    // returns false if the search was exhausted instead, leaving nothing to resume.
+    bool Resume(size_t limit) {
+        if (suspended_depth_ < 0) return false;
+        limit_ = limit;
+        int depth = Backtrack(suspended_depth_);
+        suspended_depth_ = -1;
+        if (depth >= 0) Search(depth, ChooseBandAndValueToBranch(stack_->states[depth]));
+        return true;
+    }
+
+    // the depth first search, starting at the given level of the stack with the branch chosen
+    // for its state. the first configuration of the chosen band and value is assigned in a copy
+    // of the state one level down, and once the search below is exhausted it's negated in
+    // place. when the limit is reached we remember where we were so that we can resume.
+    void Search(int depth, pair<uint32_t, Cells08> band_and_value) {
+        SearchStack &stack = *stack_;
+        while (true) {
+            if (band_and_value.first == NONE) {
+                if (CountSolution(stack.states[depth])) {
+                    suspended_depth_ = depth;
+                    return;
+                }
+                depth = Backtrack(depth);
             } else {
-                BranchOnBandAndValue<1>(
-                        tables.mod3[band_and_value.first], band_and_value.second, state);
+                num_guesses_++;
+                bool consistent = band_and_value.first < 3 ?
+                                  Assign<0>(stack, depth, band_and_value) :
+                                  Assign<1>(stack, depth, band_and_value);
+                depth = consistent ? depth + 1 : Backtrack(depth + 1);
             }
+            if (depth < 0) return;
+            band_and_value = ChooseBandAndValueToBranch(stack.states[depth]);
+        }
+    }
+
+    // abandons the given level and negates the assignments above it, from the bottom up, until
+    // one is consistent. returns the level to continue from, or -1 if the search is exhausted.
+    int Backtrack(int depth) {
+        SearchStack &stack = *stack_;
+        for (depth--; depth >= 0; depth--) {
+            bool consistent = stack.bands[depth] < 3 ? Negate<0>(stack, depth) :
+                                                       Negate<1>(stack, depth);
+            if (consistent) return depth;
+        }
+        return -1;
+    }
+
+    template<int vertical>
+    static bool Assign(SearchStack &stack, int depth,
+                       const pair<uint32_t, Cells08> &band_and_value) {
+        int band_idx = tables.mod3[band_and_value.first];
+        const State &state = stack.states[depth];
+        // we enter with two or more possible configurations for this value
+        Cells08 value_configurations =
+                state.Configurations(vertical, band_idx) & band_and_value.second;
+        // assign the first configuration by eliminating the others
+        Cells08 assignment_elims = value_configurations.ClearLowBit();
+        Cells08 negation_elims = value_configurations ^ assignment_elims;
+        // in reverse the negation goes first, and the assignment is made in place after it
+        if (kReverse) swap(assignment_elims, negation_elims);
+        stack.negations[depth] = negation_elims;
+        stack.bands[depth] = (uint8_t) band_and_value.first;
+        State &assigned = stack.states[depth + 1];
+        assigned.CopyForGuess(state);
+        assigned.Eliminations(vertical, band_idx) |= assignment_elims;
+        return BandEliminate<vertical>(assigned, band_idx);
+    }
+
+    template<int vertical>
+    static bool Negate(SearchStack &stack, int depth) {
+        int band_idx = tables.mod3[stack.bands[depth]];
+        State &state = stack.states[depth];
+        state.Eliminations(vertical, band_idx) |= stack.negations[depth];
+        return BandEliminate<vertical>(state, band_idx);
+    }
+
+    // the subtrees the search would branch into below the given state, minus any whose
+    // propagation fails. returns the number of children written, or -1 if the state is solved.
+    static int Branch(const State &state, State *children) {
+        auto band_and_value = ChooseBandAndValueToBranch(state);
+        if (band_and_value.first == NONE) return -1;
+        int band_idx = tables.mod3[band_and_value.first];
+        return band_and_value.first < 3 ?
+               Branch<0>(band_idx, band_and_value.second, state, children) :
+               Branch<1>(band_idx, band_and_value.second, state, children);
+    }
+
+    template<int vertical>
+    static int Branch(int band_idx, const Cells08 &value_mask, const State &state,
+                      State *children) {
+        Cells08 value_configurations = state.Configurations(vertical, band_idx) & value_mask;
+        Cells08 assignment_elims = value_configurations.ClearLowBit();
+        Cells08 negation_elims = value_configurations ^ assignment_elims;
+        int num_children = 0;
+        for (const Cells08 &elims : {assignment_elims, negation_elims}) {
+            State &child = children[num_children];
+            child.CopyForGuess(state);
+            child.Eliminations(vertical, band_idx) |= elims;
+            if (BandEliminate<vertical>(child, band_idx)) num_children++;
         }
+        return num_children;
     }
 
     size_t SafeCountSolutionsConsistentWithPartialAssignment(State state, size_t limit) {
@@ -597,19 +835,33 @@ struct SolverDpllTriadSimd {
         state.boxen[indexing.box].cells = state.boxen[indexing.box].cells.and_not(
                 tables.cell_assignment_eliminations[digit - '1'][indexing.elem]);
         // merge band eliminations; we'll propagate after all clue are processed.
-        state.bands[0][indexing.box_i].eliminations = Cells08::X_Y_and_Z_or(
+        Cells08 &h_band_eliminations = state.Eliminations(0, indexing.box_i);
+        h_band_eliminations = Cells08::X_Y_and_Z_or(
                 tables.peer_x_elem_to_config_mask[indexing.box_j][indexing.elem_i],
                 Cells08::All(candidate),
-                state.bands[0][indexing.box_i].eliminations);
-        state.bands[1][indexing.box_j].eliminations = Cells08::X_Y_and_Z_or(
+                h_band_eliminations);
+        Cells08 &v_band_eliminations = state.Eliminations(1, indexing.box_j);
+        v_band_eliminations = Cells08::X_Y_and_Z_or(
                 tables.peer_x_elem_to_config_mask[indexing.box_i][indexing.elem_j],
                 Cells08::All(candidate),
-                state.bands[1][indexing.box_j].eliminations);
+                v_band_eliminations);
     }
 
     // We could set the initial clues in other ways, including one box update for each clue, or
     // one batch box update for each box. But it's fastest to start with 6 batched band updates.
     static bool InitVanillaByBand(const char *input, State &state) {
+        InitClues(input, state);
+        // thanks to the merging of band updates the puzzle is almost always fully initialized
+        // after the first of these calls. most will be no-ops, but we've still got to do them
+        // since this cannot be guaranteed.
+        return BandEliminate<0>(state, 0, 1) && BandEliminate<1>(state, 0, 1) &&
+               BandEliminate<0>(state, 1, 2) && BandEliminate<1>(state, 1, 2) &&
+               BandEliminate<0>(state, 2, 0) && BandEliminate<1>(state, 2, 0);
+    }
+
+    // applies the clues of a vanilla puzzle to the state without propagating the resulting
+    // band eliminations.
+    static void InitClues(const char *input, State &state) {
         uint64_t clues64 = WhichDots64(input) ^ (uint64_t)-1ll;
         while (clues64) {
             int cell_idx = LowOrderBitIndex64(clues64);
@@ -625,12 +877,6 @@ struct SolverDpllTriadSimd {
         if (input[80] != '.') {
             InitClue(input, state, 80);
         }
-        // thanks to the merging of band updates the puzzle is almost always fully initialized
-        // after the first of these calls. most will be no-ops, but we've still got to do them
-        // since this cannot be guaranteed.
-        return BandEliminate<0>(state, 0, 1) && BandEliminate<1>(state, 0, 1) &&
-               BandEliminate<0>(state, 1, 2) && BandEliminate<1>(state, 1, 2) &&
-               BandEliminate<0>(state, 2, 0) && BandEliminate<1>(state, 2, 0);
     }
 
     static bool InitPencilmarkByBox(const char *input, State &state) {
@@ -679,26 +925,352 @@ struct SolverDpllTriadSimd {
 
     size_t SolveSudoku(const char *input, size_t limit,
                        char *solution, size_t *num_guesses) {
+        return SolveSudoku(input, input[81] >= '.', limit, solution, num_guesses);
+    }
+
+    size_t SolveSudoku(const char *input, bool pencilmark, size_t limit,
+                       char *solution, size_t *num_guesses) {
         limit_ = limit;
         num_solutions_ = 0;
         num_guesses_ = 0;
-        bool pencilmark = input[81] >= '.';
 
         State state;
         if (pencilmark ? InitPencilmarkByBox(input, state) : InitVanillaByBand(input, state)) {
             CountSolutionsConsistentWithPartialAssignment(state);
-            if (solution_mode == 1) ExtractSolution(solution_, solution);
+            if (solution_mode == 1 || solution_mode == 3 || kReverse) {
+                ExtractSolution(solution_, solution);
+            }
         }
         if (solution_mode != 2) *num_guesses = num_guesses_;
         return num_solutions_;
     };
+
+    // like SolveSudoku, but continues from a state whose clues have already been propagated.
+    size_t SolvePropagated(State &state, size_t limit, char *solution, size_t *num_guesses) {
+        limit_ = limit;
+        num_solutions_ = 0;
+        num_guesses_ = 0;
+
+        CountSolutionsConsistentWithPartialAssignment(state);
+        if (solution_mode == 1 || solution_mode == 3 || kReverse) {
+            ExtractSolution(solution_, solution);
+        }
+        if (solution_mode != 2) *num_guesses = num_guesses_;
+        return num_solutions_;
+    }
+};
+
+
+// Most vanilla puzzles in practice are solved by propagating their clues, without any guessing.
+// For batches of these we have a bulk mode that propagates the States of several puzzles at
+// once, packed side by side in wider vectors. Lanes types describe the packing: OneLane uses the
+// Cells08 and Cells16 vectors of a single State, while TwoLanes packs two puzzles into 256-bit
+// band and 512-bit box vectors.
+//
+// Rather than following each elimination to its consequences depth first (which only works
+// for one puzzle at a time), bulk propagation proceeds in rounds. Each round restricts every box
+// by the configurations of its two bands, then every band by the eliminations its boxes sent,
+// until no band has pending eliminations in any lane. The updates in a round are independent of
+// one another, so even with one lane this is quicker than the recursion for easy puzzles.
+// Either way propagation only removes candidates that can't be part of a solution, so solution
+// counts are the same, and a lane that ends with every band fixed holds the puzzle's unique
+// solution. The regular search continues the puzzles bulk propagation doesn't finish from their
+// propagated States rather than from their clues. These don't always match the States the
+// recursion would have reached, so such a puzzle can take a different number of guesses than
+// when solved on its own, and of several solutions it may find a different one first.
+struct OneLane {
+    static constexpr int kLanes = 1;
+    using C08 = Cells08;
+    using C16 = Cells16;
+
+    static C08 Broadcast(const Cells08 &x) { return x; }
+    static C16 Broadcast(const Cells16 &x) { return x; }
+    static C08 Pack(const Cells08 *x) { return x[0]; }
+    static C16 Pack(const Cells16 *x) { return x[0]; }
+    static Cells08 Unpack(const C08 &x, int) { return x; }
+    static Cells16 Unpack(const C16 &x, int) { return x; }
+    static uint32_t WhichNonZero(const C08 &x) { return !x.AllZero(); }
+    static uint32_t WhichLessThan(const C16 &x, const C16 &y) { return x.AnyLessThan(y); }
+};
+
+#if(defined __AVX512BW__ && defined __AVX512VL__)
+struct TwoLanes {
+    static constexpr int kLanes = 2;
+    using C08 = Bitvec08x16x2;
+    using C16 = Bitvec16x16x2;
+
+    static C08 Broadcast(const Cells08 &x) { return C08::Broadcast(x); }
+    static C16 Broadcast(const Cells16 &x) { return C16::Broadcast(x); }
+    static C08 Pack(const Cells08 *x) { return C08{x[0], x[1]}; }
+    static C16 Pack(const Cells16 *x) { return C16{x[0], x[1]}; }
+    static Cells08 Unpack(const C08 &x, int lane) { return x.Get(lane); }
+    static Cells16 Unpack(const C16 &x, int lane) { return x.Get(lane); }
+    static uint32_t WhichNonZero(const C08 &x) { return x.WhichNonZero(); }
+    static uint32_t WhichLessThan(const C16 &x, const C16 &y) { return x.WhichLessThan(y); }
+};
+
+using BulkLanes = TwoLanes;
+#else
+using BulkLanes = OneLane;
+#endif
+
+// the shuffle controls and masks used by bulk propagation, reproduced in each lane.
+template<typename Lanes>
+struct LaneTables {
+    using C08 = typename Lanes::C08;
+    using C16 = typename Lanes::C16;
+
+    C08 triads_shift1_to_config_elims[3];
+    C08 triads_shift2_to_config_elims[3];
+    C16 triads_shift0_to_config_elims16[9];
+    C16 triads_shift1_to_config_elims16[9];
+    C16 triads_shift2_to_config_elims16[9];
+    C16 shuffle_configs_to_triads[2];
+    C16 pos_triads_to_candidates[2][2];
+    C16 cell3x3_mask;
+    C16 row_rotate_3x3_1;
+    C16 row_rotate_3x3_2;
+    C16 split_triads;
+    C16 box_minimums;
+    C16 threes;
+    C08 triad_kAll;
+
+    LaneTables() noexcept {
+        for (int i = 0; i < 3; i++) {
+            triads_shift1_to_config_elims[i] = Lanes::Broadcast(tables.triads_shift1_to_config_elims[i]);
+            triads_shift2_to_config_elims[i] = Lanes::Broadcast(tables.triads_shift2_to_config_elims[i]);
+        }
+        for (int i = 0; i < 9; i++) {
+            triads_shift0_to_config_elims16[i] = Lanes::Broadcast(tables.triads_shift0_to_config_elims16[i]);
+            triads_shift1_to_config_elims16[i] = Lanes::Broadcast(tables.triads_shift1_to_config_elims16[i]);
+            triads_shift2_to_config_elims16[i] = Lanes::Broadcast(tables.triads_shift2_to_config_elims16[i]);
+        }
+        for (int i = 0; i < 2; i++) {
+            shuffle_configs_to_triads[i] = Lanes::Broadcast(tables.shuffle_configs_to_triads[i]);
+            for (int j = 0; j < 2; j++) {
+                pos_triads_to_candidates[i][j] = Lanes::Broadcast(tables.pos_triads_to_candidates[i][j]);
+            }
+        }
+        cell3x3_mask = Lanes::Broadcast(tables.cell3x3_mask);
+        row_rotate_3x3_1 = Lanes::Broadcast(tables.row_rotate_3x3_1);
+        row_rotate_3x3_2 = Lanes::Broadcast(tables.row_rotate_3x3_2);
+        split_triads = Lanes::Broadcast(
+                Cells16{{0xffff, 0xffff, 0xffff, 0xffff, shuf03, shuf07, 0xffff, 0xffff},
+                        {0xffff, 0xffff, 0xffff, 0xffff, 0xffff, 0xffff, shuf03, 0xffff}});
+        box_minimums = Lanes::Broadcast(Cells16{1, 1, 1, 6, 1, 1, 1, 6, 1, 1, 1, 6, 6, 6, 6, 0});
+        threes = Lanes::Broadcast(Cells16::All(3));
+        triad_kAll = Lanes::Broadcast(Cells08{0x0, 0x0, 0x0, kAll, 0x0, 0x0, 0x0, 0x0});
+    }
+
+    static const LaneTables &Get() {
+        static const LaneTables lane_tables{};
+        return lane_tables;
+    }
 };
 
+// propagates the packed States of Lanes::kLanes puzzles together. the methods below mirror
+// their counterparts in SolverDpllTriadSimd, so refer there for the details.
+template<typename Lanes>
+struct BulkPropagator {
+    using C08 = typename Lanes::C08;
+    using C16 = typename Lanes::C16;
+
+    const LaneTables<Lanes> &lane_tables_ = LaneTables<Lanes>::Get();
+    C08 configurations_[2][3];
+    C08 eliminations_[2][3];
+    C16 boxen_[9];
+    // lanes whose puzzles have turned out to have no solution
+    uint32_t contradictions_ = 0;
+
+    void Load(const State *states) {
+        Cells08 lanes08[Lanes::kLanes];
+        Cells16 lanes16[Lanes::kLanes];
+        for (int vertical = 0; vertical < 2; vertical++) {
+            for (int band_idx = 0; band_idx < 3; band_idx++) {
+                for (int lane = 0; lane < Lanes::kLanes; lane++) {
+                    lanes08[lane] = states[lane].Configurations(vertical, band_idx);
+                }
+                configurations_[vertical][band_idx] = Lanes::Pack(lanes08);
+                for (int lane = 0; lane < Lanes::kLanes; lane++) {
+                    lanes08[lane] = states[lane].Eliminations(vertical, band_idx);
+                }
+                eliminations_[vertical][band_idx] = Lanes::Pack(lanes08);
+            }
+        }
+        for (int box_idx = 0; box_idx < 9; box_idx++) {
+            for (int lane = 0; lane < Lanes::kLanes; lane++) {
+                lanes16[lane] = states[lane].boxen[box_idx].cells;
+            }
+            boxen_[box_idx] = Lanes::Pack(lanes16);
+        }
+        contradictions_ = 0;
+    }
+
+    void Store(int lane, State &state) const {
+        for (int vertical = 0; vertical < 2; vertical++) {
+            for (int band_idx = 0; band_idx < 3; band_idx++) {
+                state.SetConfigurations(
+                        vertical, band_idx, Lanes::Unpack(configurations_[vertical][band_idx], lane));
+                state.Eliminations(vertical, band_idx) =
+                        Lanes::Unpack(eliminations_[vertical][band_idx], lane);
+            }
+        }
+        for (int box_idx = 0; box_idx < 9; box_idx++) {
+            state.boxen[box_idx].cells = Lanes::Unpack(boxen_[box_idx], lane);
+        }
+    }
+
+    void Propagate() {
+        while (true) {
+            uint32_t pending = 0;
+            for (int vertical = 0; vertical < 2; vertical++) {
+                for (int band_idx = 0; band_idx < 3; band_idx++) {
+                    pending |= Lanes::WhichNonZero(configurations_[vertical][band_idx] &
+                                                   eliminations_[vertical][band_idx]);
+                }
+            }
+            // lanes with contradictions may still have pending eliminations, but since every
+            // round only removes candidates they can't keep us going forever.
+            if ((pending & ~contradictions_) == 0) return;
+
+            C16 candidates[9];
+            for (auto &box_candidates : candidates) box_candidates = C16::All(kAll);
+            for (int band_idx = 0; band_idx < 3; band_idx++) {
+                BandEliminate<0>(band_idx, candidates);
+                BandEliminate<1>(band_idx, candidates);
+            }
+            for (int box_idx = 0; box_idx < 9; box_idx++) {
+                BoxRestrict(box_idx, candidates[box_idx]);
+            }
+        }
+    }
+
+    // applies pending eliminations to the band and restricts the candidates of its box peers.
+    template<int vertical>
+    void BandEliminate(int band_idx, C16 *candidates) {
+        C08 &configurations = configurations_[vertical][band_idx];
+        configurations = configurations.and_not(eliminations_[vertical][band_idx]);
+
+        C16 triads = ConfigurationsToPositiveTriads(configurations);
+        C16 counts = triads.Popcounts9();
+        C16 asserting = triads & counts.WhichEqual(lane_tables_.threes);
+        C08 lo = asserting.GetLo();
+        C08 hi = asserting.GetHi();
+        configurations = configurations.and_not(C08::X_Y_or_Z_or(
+                lo.RotateCols().Shuffle(lane_tables_.triads_shift1_to_config_elims[0]),
+                lo.RotateCols().Shuffle(lane_tables_.triads_shift2_to_config_elims[0]),
+                lo.Shuffle(lane_tables_.triads_shift1_to_config_elims[1])));
+        configurations = configurations.and_not(C08::X_Y_or_Z_or(
+                lo.Shuffle(lane_tables_.triads_shift2_to_config_elims[1]),
+                hi.RotateCols().Shuffle(lane_tables_.triads_shift1_to_config_elims[2]),
+                hi.RotateCols().Shuffle(lane_tables_.triads_shift2_to_config_elims[2])));
+        triads = ConfigurationsToPositiveTriads(configurations);
+
+        auto &box_peers = tables.box_peers[vertical][band_idx];
+        C08 peer_triads[3]{ triads.GetLo(), triads.GetLo().RotateCols(), triads.GetHi() };
+        for (int peer = 0; peer < 3; peer++) {
+            candidates[box_peers[peer]] &= PositiveTriadsToBoxCandidates(peer_triads[peer], vertical);
+        }
+    }
+
+    // restricts the box to the given candidates and collects the resulting band eliminations.
+    void BoxRestrict(int box_idx, const C16 &candidates) {
+        C16 &box = boxen_[box_idx];
+        if (box.SubsetOf(candidates)) return;
+        C16 eliminating = box.and_not(candidates);
+
+        int box_i = tables.div3[box_idx];
+        int box_j = tables.mod3[box_idx];
+        do {
+            box = box.and_not(eliminating);
+            C16 counts = box.Popcounts9();
+            contradictions_ |= Lanes::WhichLessThan(counts, lane_tables_.box_minimums);
+
+            C16 triggered = counts.WhichEqual(lane_tables_.box_minimums);
+            C16 all_assertions = box & triggered;
+            GatherTriadClauseAssertions(
+                    box, [](const C16 &x) { return x.RotateRows(); }, all_assertions);
+            GatherTriadClauseAssertions(
+                    box, [](const C16 &x) { return x.RotateCols(); }, all_assertions);
+
+            AssertionsToEliminations(all_assertions, box_i, box_j, eliminating,
+                                     eliminations_[0][box_i], eliminations_[1][box_j]);
+        } while (eliminating.Intersects(box));
+    }
+
+    void AssertionsToEliminations(const C16 &assertions, int box_i, int box_j,
+                                  C16 &box_eliminations,
+                                  C08 &h_band_eliminations, C08 &v_band_eliminations) const {
+        auto cell_assertions_only = assertions & lane_tables_.cell3x3_mask;
+        C16 across_rows = cell_assertions_only;
+        across_rows |= across_rows.RotateRows();
+        across_rows |= across_rows.RotateRows2();
+        C16 across_cols = cell_assertions_only;
+        across_cols |= across_cols.RotateCols();
+        across_cols |= across_cols.RotateCols2();
+        C16 new_box_eliminations = C16::X_Y_or_Z_or(
+                across_cols,
+                across_cols.Shuffle(lane_tables_.row_rotate_3x3_1),
+                across_cols.Shuffle(lane_tables_.row_rotate_3x3_2));
+        new_box_eliminations = C16::X_Y_or_Z_or(
+                new_box_eliminations, across_rows, cell_assertions_only.WhichNonZero());
+        box_eliminations = C16::X_Y_xor_Z_or(
+                new_box_eliminations, cell_assertions_only, box_eliminations);
+
+        C16 hv_neg_triad_assertions{HorizontalTriads(assertions), assertions.GetHi()};
+        C16 hv_pos_triad_assertions{HorizontalTriads(new_box_eliminations),
+                                    new_box_eliminations.GetHi()};
+        C16 new_eliminations = C16::X_Y_or_Z_or(
+                hv_neg_triad_assertions.Shuffle(
+                        lane_tables_.triads_shift0_to_config_elims16[box_j * 3 + box_i]),
+                hv_pos_triad_assertions.Shuffle(
+                        lane_tables_.triads_shift1_to_config_elims16[box_j * 3 + box_i]),
+                hv_pos_triad_assertions.Shuffle(
+                        lane_tables_.triads_shift2_to_config_elims16[box_j * 3 + box_i]));
+        h_band_eliminations |= new_eliminations.GetLo();
+        v_band_eliminations |= new_eliminations.GetHi();
+    }
+
+    C08 HorizontalTriads(const C16 &cells) const {
+        C16 split_triads = cells.Shuffle(lane_tables_.split_triads);
+        return split_triads.GetLo() | split_triads.GetHi();
+    }
+
+    template<typename RotateFn>
+    static void GatherTriadClauseAssertions(const C16 &cells, RotateFn rotate, C16 &assertions) {
+        auto one_or_more = cells;
+        auto rotated = rotate(cells);
+        auto two_or_more = one_or_more & rotated;
+        one_or_more |= rotated;
+        rotated = rotate(rotated);
+        two_or_more = C16::X_Y_and_Z_or(one_or_more, rotated, two_or_more);
+        one_or_more |= rotated;
+        rotated = rotate(rotated);
+        two_or_more = C16::X_Y_and_Z_or(one_or_more, rotated, two_or_more);
+        assertions = C16::X_Y_andnot_Z_or(cells, two_or_more, assertions);
+    }
+
+    C16 ConfigurationsToPositiveTriads(const C08 &configurations) const {
+        C16 tmp{configurations, configurations};
+        return tmp.Shuffle(lane_tables_.shuffle_configs_to_triads[0]) |
+               tmp.Shuffle(lane_tables_.shuffle_configs_to_triads[1]);
+    }
+
+    C16 PositiveTriadsToBoxCandidates(const C08 &triads, int orientation) const {
+        C08 triads_with_kAll = triads | lane_tables_.triad_kAll;
+        C16 tmp{triads_with_kAll, triads_with_kAll};
+        return tmp.Shuffle(lane_tables_.pos_triads_to_candidates[orientation][0]) |
+               tmp.Shuffle(lane_tables_.pos_triads_to_candidates[orientation][1]);
+    }
+};
 
 struct GeneratorDpllTriadSimd {
     SolverDpllTriadSimd<0> solver_{};
     Util util_;
 
+    GeneratorDpllTriadSimd() = default;
+    explicit GeneratorDpllTriadSimd(uint64_t random_seed) : util_(random_seed) {}
+
     // takes a partial puzzle (vanilla or pencilmark) and adds random clues to reconstrain it
     // until there is a unique solution. this procedure is fast, but biased in the sense that
     // different puzzles may arise with widely varying probabilities and we make no effort
@@ -756,44 +1328,394 @@ struct GeneratorDpllTriadSimd {
         return false;
     }
 
+    // like Constrain for a vanilla puzzle, but only adds clues at cells the mask allows (those
+    // where the mask isn't '.'), and adds them by groups of cells that are symmetric under the
+    // given symmetry (see SymmetricGroup), so a symmetric puzzle stays symmetric.
+    bool ConstrainMasked(const char *mask, int symmetry, char *puzzle) {
+        State state;
+        if (!SolverDpllTriadSimd<0>::InitVanillaByBand(puzzle, state)) return false;
+        size_t num_solutions = solver_.SafeCountSolutionsConsistentWithPartialAssignment(state, 2);
+        if (num_solutions < 2) return num_solutions == 1;
+
+        for (int cell : util_.Permutation(81)) {
+            if (puzzle[cell] != '.' || mask[cell] == '.') continue;
+            int group[4];
+            int group_size = SymmetricGroup(cell, symmetry, mask, group);
+            for (int i = 0; i < group_size; i++) {
+                if (puzzle[group[i]] != '.') continue;
+                const BoxIndexing &indexing = tables.box_indexing[group[i]];
+                uint16_t candidates = state.boxen[indexing.box].cells.Extract(indexing.elem);
+                // take the first candidate in random order that leaves a solution. there is one
+                // as long as the state has a solution.
+                for (int value : util_.Permutation(9)) {
+                    uint16_t candidate = 1u << (uint32_t) value;
+                    if (!(candidates & candidate)) continue;
+                    Cells16 restrict = state.boxen[indexing.box].cells;
+                    restrict.Insert(indexing.elem, candidate);
+                    State test_state = state;
+                    if (!SolverDpllTriadSimd<0>::BoxRestrict<0>(test_state, indexing.box,
+                                                                restrict)) {
+                        continue;
+                    }
+                    size_t test_solutions =
+                            solver_.SafeCountSolutionsConsistentWithPartialAssignment(
+                                    test_state, 2);
+                    if (test_solutions > 0) {
+                        state = test_state;
+                        num_solutions = test_solutions;
+                        puzzle[group[i]] = (char) ('1' + value);
+                        break;
+                    }
+                }
+            }
+            // finish the group before returning so it's filled symmetrically.
+            if (num_solutions == 1) return true;
+        }
+        return false;
+    }
+
     // minimizes a vanilla or pencilmark puzzle by testing removal of all clues in random order,
     // restoring any clue that's required to keep the solution unique. if the 'monotonic' flag
     // is passed, returns true only if we had a minimal puzzle after the first restored clue.
     bool Minimize(bool pencilmark, bool monotonic, char *puzzle) {
-        bool restored_clue = false;
-        vector<int> permutation = util_.Permutation(729);
-        for (int cell_or_literal : permutation) {
+        vector<int> clues;
+        vector<int> group_ends;
+        for (int cell_or_literal : util_.Permutation(729)) {
             if (pencilmark) {
                 if (puzzle[cell_or_literal] != '.') continue;
             } else {
                 if (cell_or_literal >= 81 || puzzle[cell_or_literal] == '.') continue;
             }
-            char constraint = puzzle[cell_or_literal];
-            State state;
-            if (pencilmark) {
-                puzzle[cell_or_literal] = (char)('1' + (cell_or_literal % 9));
-                SolverDpllTriadSimd<0>::InitPencilmarkByBox(puzzle, state);
+            clues.push_back(cell_or_literal);
+            group_ends.push_back((int) clues.size());
+        }
+        return MinimizeGroups(pencilmark, monotonic, puzzle, clues, group_ends);
+    }
+
+    // like Minimize for a vanilla puzzle, but only tests removal of clues at cells the mask
+    // allows, and removes clues by groups of cells that are symmetric under the given symmetry.
+    // a group is kept if any of its clues is required.
+    bool MinimizeMasked(const char *mask, int symmetry, bool monotonic, char *puzzle) {
+        vector<int> clues;
+        vector<int> group_ends;
+        bool grouped[81]{};
+        for (int cell : util_.Permutation(81)) {
+            if (grouped[cell] || puzzle[cell] == '.' || mask[cell] == '.') continue;
+            int group[4];
+            int group_size = SymmetricGroup(cell, symmetry, mask, group);
+            for (int i = 0; i < group_size; i++) {
+                if (grouped[group[i]] || puzzle[group[i]] == '.') continue;
+                grouped[group[i]] = true;
+                clues.push_back(group[i]);
+            }
+            group_ends.push_back((int) clues.size());
+        }
+        return MinimizeGroups(false, monotonic, puzzle, clues, group_ends);
+    }
+
+private:
+    struct MinimizeState {
+        bool pencilmark;
+        bool monotonic;
+        bool test_negations;
+        bool restored_clue;
+        char *puzzle;
+        // group i holds clues[group_ends[i-1]:group_ends[i]], in the order they're tested.
+        const int *clues;
+        const int *group_ends;
+
+        int GroupBegin(int group) const { return group ? group_ends[group - 1] : 0; }
+    };
+
+    // tests removal of each group of clues in turn, restoring any group that's required to keep
+    // the solution unique. clues outside the groups are left in place.
+    //
+    // rather than propagating the remaining clues from scratch for every removal we test, we
+    // split the groups in testing order and, before testing the first half, propagate the second
+    // half into a copy of the state holding the clues outside both halves; then, before testing
+    // the second half, we propagate the clues of the first half that were kept. applied
+    // recursively this propagates each clue O(log n) times instead of O(n) times.
+    //
+    // if the puzzle has a unique solution, a group can be removed exactly when no solution of
+    // the other clues violates one of its clues, so we test the other clues together with each
+    // clue's negation for a single solution instead of counting solutions of the other clues up
+    // to two. the negation is a strong constraint that usually fails after a few guesses, which
+    // matters most for pencilmark puzzles where a count to two searches a large tree.
+    bool MinimizeGroups(bool pencilmark, bool monotonic, char *puzzle, const vector<int> &clues,
+                        const vector<int> &group_ends) {
+        if (group_ends.empty()) return true;
+
+        // the clues outside the groups, which stay in the puzzle throughout.
+        vector<int> fixed;
+        vector<bool> in_group(729);
+        for (int clue : clues) in_group[clue] = true;
+        for (int cell_or_literal = 0; cell_or_literal < (pencilmark ? 729 : 81);
+             cell_or_literal++) {
+            if (!in_group[cell_or_literal] && IsClue(pencilmark, puzzle, cell_or_literal)) {
+                fixed.push_back(cell_or_literal);
+            }
+        }
+
+        State state;
+        bool consistent = AddClues(pencilmark, puzzle, fixed.data(), (int) fixed.size(), state);
+        State all_state = state;
+        bool all_consistent = consistent && AddClues(pencilmark, puzzle, clues.data(),
+                                                     (int) clues.size(), all_state);
+        size_t num_solutions = all_consistent ?
+                solver_.SafeCountSolutionsConsistentWithPartialAssignment(all_state, 2) : 0;
+        if (num_solutions > 1) {
+            // every clue is required to keep the solutions we have, so nothing can go.
+            return true;
+        }
+
+        MinimizeState minimize{pencilmark, monotonic, num_solutions == 1, false, puzzle,
+                               clues.data(), group_ends.data()};
+        return MinimizeRange(minimize, 0, (int) group_ends.size(), state, consistent);
+    }
+
+    // tests removal of groups[begin:end] in order, given a state holding the clues outside the
+    // range that are still in the puzzle. returns false if a monotonic minimization failed.
+    bool MinimizeRange(MinimizeState &minimize, int begin, int end, const State &state,
+                       bool consistent) {
+        if (end - begin == 1) {
+            return TestRemoval(minimize, begin, state, consistent);
+        }
+        int middle = begin + (end - begin) / 2;
+        int middle_clue = minimize.GroupBegin(middle), end_clue = minimize.GroupBegin(end);
+        State half_state = state;
+        bool half_consistent = consistent && AddClues(minimize.pencilmark, minimize.puzzle,
+                                                      minimize.clues + middle_clue,
+                                                      end_clue - middle_clue, half_state);
+        if (!MinimizeRange(minimize, begin, middle, half_state, half_consistent)) {
+            return false;
+        }
+
+        // a group is removed or kept as a whole, so whether its first clue is still there tells.
+        int kept[729];
+        int num_kept = 0;
+        for (int group = begin; group < middle; group++) {
+            int group_begin = minimize.GroupBegin(group);
+            if (!IsClue(minimize.pencilmark, minimize.puzzle, minimize.clues[group_begin])) {
+                continue;
+            }
+            for (int i = group_begin; i < minimize.group_ends[group]; i++) {
+                kept[num_kept++] = minimize.clues[i];
+            }
+        }
+        half_state = state;
+        half_consistent = consistent && AddClues(minimize.pencilmark, minimize.puzzle,
+                                                 kept, num_kept, half_state);
+        return MinimizeRange(minimize, middle, end, half_state, half_consistent);
+    }
+
+    // given a state holding every other clue still in the puzzle, removes the group unless it's
+    // required to keep the solution unique.
+    bool TestRemoval(MinimizeState &minimize, int group, const State &state, bool consistent) {
+        int group_begin = minimize.GroupBegin(group), group_end = minimize.group_ends[group];
+        bool required = false;
+        if (consistent) {
+            if (minimize.test_negations) {
+                for (int i = group_begin; i < group_end && !required; i++) {
+                    State negated = state;
+                    required = Negate(minimize.pencilmark, minimize.puzzle, minimize.clues[i],
+                                      negated) &&
+                               solver_.SafeCountSolutionsConsistentWithPartialAssignment(
+                                       negated, 1) > 0;
+                }
             } else {
-                puzzle[cell_or_literal] = '.';
-                SolverDpllTriadSimd<0>::InitVanillaByBand(puzzle, state);
+                required = solver_.SafeCountSolutionsConsistentWithPartialAssignment(
+                        state, 2) > 1;
+            }
+        }
+        if (required) {
+            minimize.restored_clue = true;
+            return true;
+        }
+        for (int i = group_begin; i < group_end; i++) {
+            int cell_or_literal = minimize.clues[i];
+            minimize.puzzle[cell_or_literal] =
+                    minimize.pencilmark ? (char) ('1' + (cell_or_literal % 9)) : '.';
+        }
+        return !(minimize.monotonic && minimize.restored_clue);
+    }
+
+    static bool IsClue(bool pencilmark, const char *puzzle, int cell_or_literal) {
+        return pencilmark ? puzzle[cell_or_literal] == '.' : puzzle[cell_or_literal] != '.';
+    }
+
+    // propagates the given clues of the puzzle into a state. for vanilla puzzles these are
+    // cells, and for pencilmark puzzles literals whose candidate is eliminated.
+    static bool AddClues(bool pencilmark, const char *puzzle, const int *clues, int num_clues,
+                         State &state) {
+        if (!pencilmark) {
+            for (int i = 0; i < num_clues; i++) {
+                SolverDpllTriadSimd<0>::InitClue(puzzle, state, clues[i]);
             }
-            if (solver_.SafeCountSolutionsConsistentWithPartialAssignment(state, 2) > 1) {
-                puzzle[cell_or_literal] = constraint;
-                restored_clue = true;
-            } else if (monotonic && restored_clue) {
+            return SolverDpllTriadSimd<0>::BandEliminate<0>(state, 0, 1) &&
+                   SolverDpllTriadSimd<0>::BandEliminate<1>(state, 0, 1) &&
+                   SolverDpllTriadSimd<0>::BandEliminate<0>(state, 1, 2) &&
+                   SolverDpllTriadSimd<0>::BandEliminate<1>(state, 1, 2) &&
+                   SolverDpllTriadSimd<0>::BandEliminate<0>(state, 2, 0) &&
+                   SolverDpllTriadSimd<0>::BandEliminate<1>(state, 2, 0);
+        }
+        // gather the eliminations by box and restrict each box once.
+        uint16_t eliminations[9][16]{};
+        uint32_t boxes = 0;
+        for (int i = 0; i < num_clues; i++) {
+            const BoxIndexing &indexing = tables.box_indexing[clues[i] / 9];
+            eliminations[indexing.box][indexing.elem] |= 1u << (uint32_t) (clues[i] % 9);
+            boxes |= 1u << indexing.box;
+        }
+        while (boxes) {
+            int box_idx = LowOrderBitIndex(boxes);
+            Cells16 candidates = state.boxen[box_idx].cells;
+            for (int elem = 0; elem < 16; elem++) {
+                if (eliminations[box_idx][elem]) {
+                    candidates.Insert(elem, candidates.Extract(elem) &
+                                            ~eliminations[box_idx][elem]);
+                }
+            }
+            if (!SolverDpllTriadSimd<0>::BoxRestrict<0>(state, box_idx, candidates)) {
                 return false;
             }
+            boxes = ClearLowBit(boxes);
         }
         return true;
     }
+
+    // propagates the negation of a clue into a state: a vanilla clue's cell takes some other
+    // value, and a pencilmark clue's cell takes the eliminated value.
+    static bool Negate(bool pencilmark, const char *puzzle, int cell_or_literal, State &state) {
+        int cell = pencilmark ? cell_or_literal / 9 : cell_or_literal;
+        uint16_t candidate = pencilmark ? 1u << (uint32_t) (cell_or_literal % 9) :
+                             1u << (uint32_t) (puzzle[cell_or_literal] - '1');
+        const BoxIndexing &indexing = tables.box_indexing[cell];
+        Cells16 candidates = state.boxen[indexing.box].cells;
+        uint16_t cell_candidates = candidates.Extract(indexing.elem);
+        candidates.Insert(indexing.elem, pencilmark ? cell_candidates & candidate :
+                                         cell_candidates & ~candidate);
+        return SolverDpllTriadSimd<0>::BoxRestrict<0>(state, indexing.box, candidates);
+    }
 };
 
 
-//SolverDpllTriadSimd<0> solver_none{};
-//SolverDpllTriadSimd<1> solver_last{};
-//SolverDpllTriadSimd<2> solver_enum{};
+// everything a caller needs to solve and generate repeatedly without paying for solver
+// construction and RNG seeding on every call. this is what a TdokuContext handle points to.
+struct Context {
+    SolverDpllTriadSimd<0> solver_none{};
+    SolverDpllTriadSimd<1> solver_last{};
+    SolverDpllTriadSimd<2> solver_enum{};
+    SolverDpllTriadSimd<3> solver_first{};
+    SolverDpllTriadSimd<4> solver_reverse{};
+    GeneratorDpllTriadSimd generator;
 
-//GeneratorDpllTriadSimd generator{};
+    explicit Context(uint64_t random_seed) : generator(random_seed) {}
+    Context() = default;
+
+    size_t SolveSudoku(const char *puzzle, size_t limit, uint32_t configuration,
+                       char *solution, size_t *num_guesses) {
+        bool return_last = limit == 1 || configuration > 0;
+        if (configuration == 2) {
+            return solver_first.SolveSudoku(puzzle, limit, solution, num_guesses);
+        } else if (configuration == 3) {
+            return solver_reverse.SolveSudoku(puzzle, limit, solution, num_guesses);
+        } else if (return_last) {
+            return solver_last.SolveSudoku(puzzle, limit, solution, num_guesses);
+        } else {
+            return solver_none.SolveSudoku(puzzle, limit, solution, num_guesses);
+        }
+    }
+};
+
+Context *AsContext(TdokuContext *context) {
+    return reinterpret_cast<Context *>(context);
+}
+
+// features of the propagated state of a vanilla puzzle, from which TdokuRateEstimate predicts
+// its rating without searching. see TdokuRateFeatures for the list. returns false if the clues
+// contradict each other.
+bool RateFeatures(const char *puzzle, float *features) {
+    using Solver = SolverDpllTriadSimd<0>;
+    State state;
+    if (!Solver::InitVanillaByBand(puzzle, state)) return false;
+
+    int num_clues = 0;
+    for (int i = 0; i < 81; i++) num_clues += puzzle[i] != '.';
+    int unsolved_cells = 0, candidates = 0, bivalue_cells = 0;
+    for (const Box &box : state.boxen) {
+        for (int elem_i = 0; elem_i < 3; elem_i++) {
+            for (int elem_j = 0; elem_j < 3; elem_j++) {
+                int cell_candidates = NumBitsSet(box.cells.Extract(elem_i * 4 + elem_j));
+                if (cell_candidates > 1) {
+                    unsolved_cells++;
+                    candidates += cell_candidates;
+                    bivalue_cells += cell_candidates == 2;
+                }
+            }
+        }
+    }
+    // a band is fixed when each of its 9 values has a single configuration left.
+    int unfixed_bands = 0, excess_configurations = 0, fewest_configurations = 0;
+    for (int band = 0; band < 6; band++) {
+        int excess = state.Configurations(band / 3, band % 3).Popcount() - 9;
+        if (excess > 0) {
+            unfixed_bands++;
+            excess_configurations += excess;
+            if (!fewest_configurations || excess < fewest_configurations) {
+                fewest_configurations = excess;
+            }
+        }
+    }
+    int branch_configurations = 0;
+    auto band_and_value = Solver::ChooseBandAndValueToBranch(state);
+    if (band_and_value.first != Solver::NONE) {
+        Cells08 configurations = state.Configurations(band_and_value.first / 3,
+                                                      band_and_value.first % 3);
+        branch_configurations = (configurations & band_and_value.second).Popcount();
+    }
+
+    float *f = features;
+    *f++ = 1.0f;
+    *f++ = (float) num_clues;
+    *f++ = (float) unsolved_cells;
+    *f++ = (float) candidates;
+    *f++ = (float) bivalue_cells;
+    *f++ = (float) unfixed_bands;
+    *f++ = (float) excess_configurations;
+    *f++ = logf(1.0f + (float) excess_configurations);
+    *f++ = (float) fewest_configurations;
+    *f++ = (float) branch_configurations;
+    *f++ = unsolved_cells == 0 ? 1.0f : 0.0f;
+    return true;
+}
+
+// a search that stops after each solution, behind a TdokuSearch handle.
+struct SuspendableSearch {
+    SolverDpllTriadSimd<1> solver;
+    State state;
+    bool consistent = false;
+    bool started = false;
+
+    bool Next(char *solution, size_t *num_guesses) {
+        size_t num_found = solver.num_solutions_;
+        solver.num_guesses_ = 0;
+        if (!started) {
+            started = true;
+            solver.limit_ = 1;
+            if (consistent) solver.CountSolutionsConsistentWithPartialAssignment(state);
+        } else {
+            solver.Resume(num_found + 1);
+        }
+        if (num_guesses) *num_guesses = solver.num_guesses_;
+        if (solver.num_solutions_ == num_found) return false;
+        SolverDpllTriadSimd<1>::ExtractSolution(solver.solution_, solution);
+        return true;
+    }
+};
+
+SuspendableSearch *AsSearch(TdokuSearch *search) {
+    return reinterpret_cast<SuspendableSearch *>(search);
+}
 
 } // namespace
 
@@ -801,17 +1723,284 @@ extern "C"
 size_t TdokuSolverDpllTriadSimd(const char *puzzle, size_t limit,
                                 uint32_t configuration,
                                 char *solution, size_t *num_guesses) {
-    SolverDpllTriadSimd<0> solver_none{};
-    SolverDpllTriadSimd<1> solver_last{};
-
+    // per-thread solvers, so their search stacks are allocated once rather than on every call.
+    // none of these modes calls back into user code, so they can't be reentered.
+    thread_local SolverDpllTriadSimd<3> solver_first{};
+    thread_local SolverDpllTriadSimd<1> solver_last{};
+    thread_local SolverDpllTriadSimd<0> solver_none{};
+    thread_local SolverDpllTriadSimd<4> solver_reverse{};
+    // configurations without a meaning of their own return the last solution, as all nonzero
+    // ones did before 2 and 3 had one.
     bool return_last = limit == 1 || configuration > 0;
-    if (return_last) {
+    if (configuration == 2) {
+        return solver_first.SolveSudoku(puzzle, limit, solution, num_guesses);
+    } else if (configuration == 3) {
+        return solver_reverse.SolveSudoku(puzzle, limit, solution, num_guesses);
+    } else if (return_last) {
         return solver_last.SolveSudoku(puzzle, limit, solution, num_guesses);
     } else {
         return solver_none.SolveSudoku(puzzle, limit, solution, num_guesses);
     }
 }
 
+namespace {
+
+// the whole batch is one kind of puzzle. only a stride that can hold a pencilmark puzzle
+// needs sniffing, and then only once, since puzzles[81] of a packed vanilla batch is the
+// first cell of the next puzzle.
+bool IsPencilmarkBatch(const char *puzzles, size_t count, size_t stride) {
+    return count > 0 && stride >= 729 && puzzles[81] >= '.';
+}
+
+// stores the results for puzzle i of a batch. returns whether it has a solution.
+bool StoreBatchItem(size_t i, size_t num_solutions, const char *solution, size_t num_guesses,
+                    char *solutions, uint32_t *counts, uint32_t *guesses) {
+    if (solutions) {
+        // the solver only holds a solution for this puzzle if it found one.
+        if (num_solutions > 0) {
+            memcpy(solutions + i * 81, solution, 81);
+        } else {
+            memset(solutions + i * 81, '.', 81);
+        }
+    }
+    if (counts) counts[i] = (uint32_t) num_solutions;
+    if (guesses) guesses[i] = (uint32_t) min(num_guesses, (size_t) UINT32_MAX);
+    return num_solutions > 0;
+}
+
+// solves the puzzles at the given indices of a batch, of which there may be at most
+// BulkLanes::kLanes, and stores their results. returns the number with a solution.
+size_t SolveBatchItems(SolverDpllTriadSimd<3> &solver, BulkPropagator<BulkLanes> &propagator,
+                       const char *puzzles, const size_t *indices, int num_indices,
+                       size_t stride, bool pencilmark, size_t limit,
+                       char *solutions, uint32_t *counts, uint32_t *guesses) {
+    char solution[81];
+    size_t num_guesses = 0, num_solved = 0;
+    if (pencilmark || limit == 0) {
+        for (int k = 0; k < num_indices; k++) {
+            size_t i = indices[k];
+            size_t num_solutions = solver.SolveSudoku(
+                    puzzles + i * stride, pencilmark, limit, solution, &num_guesses);
+            num_solved += StoreBatchItem(i, num_solutions, solution, num_guesses,
+                                         solutions, counts, guesses);
+        }
+        return num_solved;
+    }
+    // vanilla puzzles are propagated together in bulk, and then searched from where propagation
+    // left them. for most puzzles that means the search finds them already solved. unused lanes
+    // repeat the first puzzle.
+    State states[BulkLanes::kLanes];
+    for (int lane = 0; lane < BulkLanes::kLanes; lane++) {
+        size_t i = indices[lane < num_indices ? lane : 0];
+        SolverDpllTriadSimd<3>::InitClues(puzzles + i * stride, states[lane]);
+    }
+    propagator.Load(states);
+    propagator.Propagate();
+    for (int lane = 0; lane < num_indices; lane++) {
+        size_t num_solutions = 0;
+        num_guesses = 0;
+        if (!(propagator.contradictions_ & (1u << lane))) {
+            propagator.Store(lane, states[lane]);
+            num_solutions = solver.SolvePropagated(states[lane], limit, solution, &num_guesses);
+        }
+        num_solved += StoreBatchItem(indices[lane], num_solutions, solution, num_guesses,
+                                     solutions, counts, guesses);
+    }
+    return num_solved;
+}
+
+// counts (solution_mode 0) or enumerates (solution_mode 2) the solutions of a single puzzle on
+// several threads. the top of the search tree is expanded breadth first until there are
+// enough subtrees to keep the workers balanced, and the subtrees are then searched as
+// independent tasks. solutions are counted in a shared total, so once it reaches the limit
+// remaining tasks are skipped, and in enumeration the running tasks stop too.
+template<int solution_mode>
+class ParallelSearch {
+    using Solver = SolverDpllTriadSimd<solution_mode>;
+
+    // subtrees per worker. the counts of sibling subtrees can differ by orders of magnitude,
+    // so we want many more tasks than workers.
+    static constexpr size_t kTasksPerWorker = 16;
+
+    struct Worker {
+        ParallelSearch *search;
+        Solver solver;
+
+        explicit Worker(ParallelSearch *search) : search(search) {
+            solver.callback_ = Report;
+            solver.callback_arg_ = this;
+        }
+    };
+
+    size_t limit_;
+    void (*callback_)(const char *, void *);
+    void *callback_arg_;
+    atomic<size_t> num_solutions_{0};
+    atomic<size_t> num_guesses_{0};
+    mutex callback_mutex_;
+
+    // every solution of an enumeration passes through here, so the workers together report
+    // at most limit_ solutions, and the callback is never called concurrently.
+    static void Report(const char *solution, void *arg) {
+        Worker &worker = *(Worker *) arg;
+        ParallelSearch &search = *worker.search;
+        size_t claimed = search.num_solutions_.fetch_add(1);
+        if (claimed < search.limit_) {
+            lock_guard<mutex> lock(search.callback_mutex_);
+            search.callback_(solution, search.callback_arg_);
+        }
+        // the limit is reached, so stop this solver as if it reached its own.
+        if (claimed + 1 >= search.limit_) worker.solver.limit_ = worker.solver.num_solutions_;
+    }
+
+    // searches the subtree below the given state for what's left of the limit. returns the
+    // number of guesses made.
+    size_t SearchTask(Worker &worker, State &task) {
+        size_t found = num_solutions_;
+        if (found >= limit_) return 0;
+        size_t task_guesses;
+        size_t count = worker.solver.SolvePropagated(task, limit_ - found, nullptr, &task_guesses);
+        // an enumeration has already counted its solutions as it reported them.
+        if (solution_mode == 0) num_solutions_ += count;
+        return task_guesses;
+    }
+
+    void CountLeaf(Worker &worker, const State &state) {
+        if (solution_mode == 2) {
+            char solution[81];
+            Solver::ExtractSolution(state, solution);
+            Report(solution, &worker);
+        } else {
+            num_solutions_++;
+        }
+    }
+
+public:
+    // a limit of 0 means no limit, as in the single threaded search.
+    ParallelSearch(size_t limit, void (*callback)(const char *, void *), void *callback_arg)
+            : limit_(limit ? limit : SIZE_MAX), callback_(callback), callback_arg_(callback_arg) {}
+
+    size_t Run(const char *input, int num_threads, size_t *num_guesses) {
+        State state;
+        bool pencilmark = input[81] >= '.';
+        if (pencilmark ? Solver::InitPencilmarkByBox(input, state) :
+            Solver::InitVanillaByBand(input, state)) {
+            Search(state, NumWorkers(num_threads));
+        }
+        if (num_guesses) *num_guesses = num_guesses_;
+        return min(num_solutions_.load(), limit_);
+    }
+
+private:
+    void Search(const State &root, int num_workers) {
+        // the frontier of the expansion is a ring buffer. each expansion replaces one subtree
+        // with at most two, and we stop as soon as there are enough, so it never overflows.
+        size_t capacity = num_workers * kTasksPerWorker;
+        State *tasks = (State *) aligned_alloc(alignof(State), capacity * sizeof(State));
+        if (!tasks) {
+            // without room for the frontier, search the whole tree on this thread instead.
+            Worker worker(this);
+            State task = root;
+            num_guesses_ += SearchTask(worker, task);
+            return;
+        }
+        size_t head = 0, num_tasks = 1;
+        tasks[0] = root;
+
+        Worker expander(this);
+        State children[2];
+        while (num_tasks > 0 && num_tasks < capacity && num_solutions_ < limit_) {
+            const State &task = tasks[head];
+            head = (head + 1) % capacity;
+            num_tasks--;
+            int num_children = Solver::Branch(task, children);
+            if (num_children < 0) {
+                CountLeaf(expander, task);
+                continue;
+            }
+            num_guesses_++;
+            for (int i = 0; i < num_children; i++) {
+                tasks[(head + num_tasks++) % capacity] = children[i];
+            }
+        }
+
+        if (num_tasks == 0) {
+            free(tasks);
+            return;
+        }
+        num_workers = (int) min((size_t) num_workers, num_tasks);
+        WorkStealingRanges ranges(num_tasks, num_workers);
+        RunWorkers(num_workers, [&](int w) {
+            Worker worker(this);
+            size_t task;
+            size_t worker_guesses = 0;
+            while (ranges.Next(w, &task)) {
+                worker_guesses += SearchTask(worker, tasks[(head + task) % capacity]);
+            }
+            num_guesses_ += worker_guesses;
+        });
+        free(tasks);
+    }
+};
+
+} // namespace
+
+extern "C"
+size_t TdokuSolveBatch(const char *puzzles, size_t count, size_t stride, size_t limit,
+                       char *solutions, uint32_t *counts, uint32_t *guesses) {
+    SolverDpllTriadSimd<3> solver{};
+    BulkPropagator<BulkLanes> propagator{};
+    bool pencilmark = IsPencilmarkBatch(puzzles, count, stride);
+    size_t num_solved = 0;
+    for (size_t first = 0; first < count; first += BulkLanes::kLanes) {
+        size_t indices[BulkLanes::kLanes];
+        int num_indices = 0;
+        for (size_t i = first; i < count && num_indices < BulkLanes::kLanes; i++) {
+            indices[num_indices++] = i;
+        }
+        num_solved += SolveBatchItems(solver, propagator, puzzles, indices, num_indices, stride,
+                                      pencilmark, limit, solutions, counts, guesses);
+    }
+    return num_solved;
+}
+
+extern "C"
+size_t TdokuSolveBatchParallel(const char *puzzles, size_t count, size_t stride, size_t limit,
+                               int num_threads, char *solutions, uint32_t *counts,
+                               uint32_t *guesses, double *wall_seconds) {
+    auto start = chrono::steady_clock::now();
+    bool pencilmark = IsPencilmarkBatch(puzzles, count, stride);
+    int num_workers = (int) min((size_t) NumWorkers(num_threads), max(count, (size_t) 1));
+    atomic<size_t> num_solved{0};
+    // results go straight to their input positions, so output order doesn't depend on which
+    // worker solved what. work stealing bounds us to 2^32 puzzles per round.
+    for (size_t first = 0; first < count; first += WorkStealingRanges::kMaxCount) {
+        size_t round = min(count - first, WorkStealingRanges::kMaxCount);
+        WorkStealingRanges ranges(round, num_workers);
+        RunWorkers(num_workers, [&](int worker) {
+            SolverDpllTriadSimd<3> solver{};
+            BulkPropagator<BulkLanes> propagator{};
+            size_t i, indices[BulkLanes::kLanes], worker_solved = 0;
+            bool more = true;
+            while (more) {
+                int num_indices = 0;
+                while (num_indices < BulkLanes::kLanes && (more = ranges.Next(worker, &i))) {
+                    indices[num_indices++] = first + i;
+                }
+                if (num_indices == 0) break;
+                worker_solved += SolveBatchItems(solver, propagator, puzzles, indices,
+                                                 num_indices, stride, pencilmark, limit,
+                                                 solutions, counts, guesses);
+            }
+            num_solved += worker_solved;
+        });
+    }
+    if (wall_seconds) {
+        *wall_seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    }
+    return num_solved;
+}
+
 extern "C"
 size_t TdokuEnumerate(const char *puzzle, size_t limit,
                       void (*callback)(const char *, void *), void *callback_arg) {
@@ -821,6 +2010,107 @@ size_t TdokuEnumerate(const char *puzzle, size_t limit,
     return solver_enum.SolveSudoku(puzzle, limit, nullptr, nullptr);
 }
 
+extern "C"
+size_t TdokuCountParallel(const char *puzzle, size_t limit, int num_threads,
+                          size_t *num_guesses) {
+    ParallelSearch<0> search(limit, nullptr, nullptr);
+    return search.Run(puzzle, num_threads, num_guesses);
+}
+
+extern "C"
+size_t TdokuEnumerateParallel(const char *puzzle, size_t limit, int num_threads,
+                              void (*callback)(const char *, void *), void *callback_arg) {
+    ParallelSearch<2> search(limit, callback, callback_arg);
+    return search.Run(puzzle, num_threads, nullptr);
+}
+
+extern "C"
+TdokuSearch *TdokuSearchCreate(const char *puzzle) {
+    void *memory = aligned_alloc(alignof(SuspendableSearch), sizeof(SuspendableSearch));
+    if (!memory) return nullptr;
+    SuspendableSearch *search = new(memory) SuspendableSearch();
+    // a paused search lives on its stack, so allocate that now rather than fail to resume.
+    if (!search->solver.ReserveStack()) {
+        TdokuSearchDestroy(reinterpret_cast<TdokuSearch *>(search));
+        return nullptr;
+    }
+    search->consistent = puzzle[81] >= '.' ?
+                         SolverDpllTriadSimd<1>::InitPencilmarkByBox(puzzle, search->state) :
+                         SolverDpllTriadSimd<1>::InitVanillaByBand(puzzle, search->state);
+    return reinterpret_cast<TdokuSearch *>(search);
+}
+
+extern "C"
+bool TdokuSearchNext(TdokuSearch *search, char *solution, size_t *num_guesses) {
+    return AsSearch(search)->Next(solution, num_guesses);
+}
+
+extern "C"
+void TdokuSearchDestroy(TdokuSearch *search) {
+    if (!search) return;
+    AsSearch(search)->~SuspendableSearch();
+    free(search);
+}
+
+extern "C"
+TdokuContext *TdokuContextCreate(uint64_t random_seed) {
+    // the solvers hold vectors that need stronger alignment than plain new guarantees.
+    void *memory = aligned_alloc(alignof(Context), sizeof(Context));
+    if (!memory) return nullptr;
+    Context *context = random_seed != 0 ? new(memory) Context(random_seed) : new(memory) Context();
+    return reinterpret_cast<TdokuContext *>(context);
+}
+
+extern "C"
+void TdokuContextDestroy(TdokuContext *context) {
+    if (!context) return;
+    AsContext(context)->~Context();
+    free(context);
+}
+
+extern "C"
+Util *TdokuContextUtil(TdokuContext *context) {
+    return &AsContext(context)->generator.util_;
+}
+
+extern "C"
+size_t TdokuContextSolverDpllTriadSimd(TdokuContext *context, const char *puzzle, size_t limit,
+                                       uint32_t configuration,
+                                       char *solution, size_t *num_guesses) {
+    return AsContext(context)->SolveSudoku(puzzle, limit, configuration, solution, num_guesses);
+}
+
+extern "C"
+size_t TdokuContextEnumerate(TdokuContext *context, const char *puzzle, size_t limit,
+                             void (*callback)(const char *, void *), void *callback_arg) {
+    SolverDpllTriadSimd<2> &solver_enum = AsContext(context)->solver_enum;
+    solver_enum.callback_ = callback;
+    solver_enum.callback_arg_ = callback_arg;
+    return solver_enum.SolveSudoku(puzzle, limit, nullptr, nullptr);
+}
+
+extern "C"
+bool TdokuContextConstrain(TdokuContext *context, bool pencilmark, char *puzzle) {
+    return AsContext(context)->generator.Constrain(pencilmark, puzzle);
+}
+
+extern "C"
+bool TdokuContextMinimize(TdokuContext *context, bool pencilmark, bool monotonic, char *puzzle) {
+    return AsContext(context)->generator.Minimize(pencilmark, monotonic, puzzle);
+}
+
+extern "C"
+bool TdokuContextConstrainMasked(TdokuContext *context, const char *mask, int symmetry,
+                                 char *puzzle) {
+    return AsContext(context)->generator.ConstrainMasked(mask, symmetry, puzzle);
+}
+
+extern "C"
+bool TdokuContextMinimizeMasked(TdokuContext *context, const char *mask, int symmetry,
+                                bool monotonic, char *puzzle) {
+    return AsContext(context)->generator.MinimizeMasked(mask, symmetry, monotonic, puzzle);
+}
+
 extern "C"
 bool TdokuConstrain(bool pencilmark, char *puzzle) {
     GeneratorDpllTriadSimd generator{};
@@ -832,3 +2122,38 @@ bool TdokuMinimize(bool pencilmark, bool monotonic, char *puzzle) {
     GeneratorDpllTriadSimd generator{};
     return generator.Minimize(pencilmark, monotonic, puzzle);
 }
+
+extern "C"
+bool TdokuConstrainMasked(const char *mask, int symmetry, char *puzzle) {
+    GeneratorDpllTriadSimd generator{};
+    return generator.ConstrainMasked(mask, symmetry, puzzle);
+}
+
+extern "C"
+bool TdokuMinimizeMasked(const char *mask, int symmetry, bool monotonic, char *puzzle) {
+    GeneratorDpllTriadSimd generator{};
+    return generator.MinimizeMasked(mask, symmetry, monotonic, puzzle);
+}
+
+extern "C"
+size_t TdokuRateFeatures(const char *puzzle, float *features) {
+    return RateFeatures(puzzle, features) ? TDOKU_NUM_RATE_FEATURES : 0;
+}
+
+extern "C"
+size_t TdokuStateBytesCopiedPerGuess() {
+    return kStateBytesCopiedPerGuess;
+}
+
+extern "C"
+const char *TdokuSimdLevel() {
+#if(defined __AVX512VL__ && defined __AVX512BW__)
+    return "avx512";
+#elif defined __AVX2__
+    return "avx2";
+#elif defined __SSE4_1__
+    return "sse4.1";
+#else
+    return "sse2";
+#endif
+}
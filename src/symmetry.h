@@ -0,0 +1,40 @@
+#ifndef TDOKU_SYMMETRY_H
+#define TDOKU_SYMMETRY_H
+
+namespace {
+
+// maps a cell to its image under one of the symmetries accepted by the masked generation
+// functions: 1 for 180 degree rotation, 2 for 90 degree rotation, 3 for a left-right mirror,
+// and 4 for a mirror in the main diagonal. any other value is the identity.
+inline int SymmetricCell(int cell, int symmetry) {
+    int row = cell / 9, col = cell % 9;
+    switch (symmetry) {
+        case 1:
+            return (8 - row) * 9 + (8 - col);
+        case 2:
+            return col * 9 + (8 - row);
+        case 3:
+            return row * 9 + (8 - col);
+        case 4:
+            return col * 9 + row;
+        default:
+            return cell;
+    }
+}
+
+// stores the cells of the group formed by a cell and its symmetric images that are allowed by
+// the mask (a '.' in the mask disallows a cell), starting with the cell itself. returns the size
+// of the group, at most 4.
+inline int SymmetricGroup(int cell, int symmetry, const char *mask, int group[4]) {
+    int size = 0;
+    int image = cell;
+    do {
+        if (mask[image] != '.') group[size++] = image;
+        image = SymmetricCell(image, symmetry);
+    } while (image != cell);
+    return size;
+}
+
+} // namespace
+
+#endif //TDOKU_SYMMETRY_H
@@ -6,6 +6,11 @@
 
 using namespace std;
 
+// out of line so that every SIMD variant of the solver shares the baseline copy.
+Util::Util() = default;
+
+Util::Util(uint64_t seed) : rng_(seed) {}
+
 void Util::RandomSeed(uint64_t seed) {
     rng_.seed(seed);
 }
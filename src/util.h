@@ -4,12 +4,15 @@
 
 class Util {
 private:
-    std::random_device rd{};
-    std::mt19937_64 rng_{rd()};
+    std::mt19937_64 rng_{std::random_device{}()};
     std::uniform_int_distribution<uint32_t> random_uint_{};
     std::uniform_real_distribution<> random_double_{0.0, 1.0};
 
 public:
+    Util();
+    // a seeded Util skips reading std::random_device.
+    explicit Util(uint64_t seed);
+
     void RandomSeed(uint64_t seed);
     uint32_t RandomUInt();
     double RandomDouble();
@@ -1,12 +1,19 @@
+#include "../include/tdoku.h"
 #include "../src/all_solvers.h"
 #include "../src/bitutil.h"
+#include "../src/grid_lib.h"
+#include "../src/symmetry.h"
 
+#include <algorithm>
 #include <chrono>
 #include <cstdlib>
 #include <cstring>
 #include <fstream>
 #include <iostream>
 #include <memory>
+#include <numeric>
+#include <random>
+#include <set>
 #include <sstream>
 #include <vector>
 
@@ -58,6 +65,837 @@ void Run(const string &testdata_filename, const Solver &solver, bool verbose) {
     if (!fail) cout << "PASS: " << solver.Id() << endl;
 }
 
+// the puzzles of the test data.
+vector<string> LoadPuzzles(const string &testdata_filename) {
+    ifstream file(testdata_filename);
+    vector<string> puzzles;
+    string line;
+    while (getline(file, line)) puzzles.push_back(line.substr(0, 81));
+    return puzzles;
+}
+
+// the pencilmark puzzle with a clue's digit as the only candidate of its cell.
+string Pencilmark(const string &puzzle) {
+    string pencilmark(729, '.');
+    for (int i = 0; i < 81; i++) {
+        for (int d = 0; d < 9; d++) {
+            if (puzzle[i] == '.' || puzzle[i] == '1' + d) pencilmark[i * 9 + d] = '1' + d;
+        }
+    }
+    return pencilmark;
+}
+
+// whether grid is a valid solution of puzzle, which may be vanilla or pencilmark.
+bool IsSolution(const string &puzzle, const char *grid) {
+    bool pencilmark = puzzle.size() >= 729;
+    for (int i = 0; i < 81; i++) {
+        if (grid[i] < '1' || grid[i] > '9') return false;
+        char clue = pencilmark ? puzzle[i * 9 + grid[i] - '1'] : puzzle[i];
+        if (pencilmark ? clue == '.' : clue != '.' && clue != grid[i]) return false;
+    }
+    for (int i = 0; i < 81; i++) {
+        for (int j = i + 1; j < 81; j++) {
+            bool peers = i / 9 == j / 9 || i % 9 == j % 9 ||
+                         (i / 27 == j / 27 && i % 9 / 3 == j % 9 / 3);
+            if (peers && grid[i] == grid[j]) return false;
+        }
+    }
+    return true;
+}
+
+// checks that batches, of an odd number of puzzles so the last bulk propagation is partly
+// empty, find the same counts as solving each puzzle with configuration 2, and the same
+// solutions where they're unique. a batch may pick a different first solution of a puzzle with
+// several, so those only need to be solutions. covers vanilla and pencilmark batches, packed
+// and newline separated, solved on one thread and on several.
+void RunBatch(const string &testdata_filename, bool verbose) {
+    vector<string> puzzles = LoadPuzzles(testdata_filename);
+    if (puzzles.size() % 2 == 0) puzzles.pop_back();
+    vector<string> pencilmarks;
+    for (const string &puzzle : puzzles) pencilmarks.push_back(Pencilmark(puzzle));
+
+    bool fail = false;
+    for (const vector<string> *batch_puzzles : {&puzzles, &pencilmarks}) {
+        size_t count = batch_puzzles->size();
+        size_t size = batch_puzzles->front().size();
+        for (size_t stride : {size, size + 1}) {
+            string joined;
+            for (const string &puzzle : *batch_puzzles) {
+                joined += puzzle + string(stride - size, '\n');
+            }
+            for (size_t limit : {(size_t) 2, (size_t) 100000}) {
+                for (int num_threads : {0, 1, 3}) {
+                    vector<char> solutions(count * 81);
+                    vector<uint32_t> counts(count);
+                    size_t num_solved = num_threads == 0 ?
+                        TdokuSolveBatch(joined.data(), count, stride, limit, solutions.data(),
+                                        counts.data(), nullptr) :
+                        TdokuSolveBatchParallel(joined.data(), count, stride, limit,
+                                                num_threads, solutions.data(), counts.data(),
+                                                nullptr, nullptr);
+                    size_t expect_solved = 0;
+                    for (size_t i = 0; i < count; i++) {
+                        const string &puzzle = (*batch_puzzles)[i];
+                        char expect_solution[81];
+                        size_t guesses;
+                        size_t expect = TdokuSolverDpllTriadSimd(puzzle.c_str(), limit, 2,
+                                                                 expect_solution, &guesses);
+                        expect_solved += expect > 0;
+                        const char *solution = &solutions[i * 81];
+                        bool this_fail = counts[i] != expect;
+                        if (expect == 0) {
+                            this_fail |= string(solution, 81) != string(81, '.');
+                        } else if (expect == 1) {
+                            this_fail |= strncmp(solution, expect_solution, 81) != 0;
+                        } else {
+                            this_fail |= !IsSolution(puzzle, solution);
+                        }
+                        if (this_fail || verbose) {
+                            cout << (this_fail ? "FAIL: " : "") << "tdoku_batch\n"
+                                 << "      puzzle:   " << puzzle << "\n"
+                                 << "      batch:    stride " << stride << ", limit " << limit
+                                 << ", " << num_threads << " threads\n"
+                                 << "      expected: " << expect << " "
+                                 << string(expect_solution, expect ? 81 : 0) << "\n"
+                                 << "      observed: " << counts[i] << " "
+                                 << string(solution, 81) << endl;
+                        }
+                        fail |= this_fail;
+                    }
+                    if (num_solved != expect_solved) {
+                        cout << "FAIL: tdoku_batch\n"
+                             << "      batch:    stride " << stride << ", limit " << limit
+                             << ", " << num_threads << " threads\n"
+                             << "      expected: " << expect_solved << " solved\n"
+                             << "      observed: " << num_solved << " solved" << endl;
+                        fail = true;
+                    }
+                }
+            }
+        }
+    }
+    if (!fail) cout << "PASS: tdoku_batch" << endl;
+}
+
+// checks that splitting the search across threads finds the same counts as the single threaded
+// solver, both up to the full count and when the limit cuts the search short.
+void RunParallel(const string &testdata_filename, bool verbose) {
+    ifstream file;
+    file.open(testdata_filename);
+    string line;
+    bool fail = false;
+    while (getline(file, line)) {
+        stringstream ss(line);
+        string puzzle, expect_str;
+        getline(ss, puzzle, ':');
+        getline(ss, expect_str, ':');
+        size_t expect = stoi(expect_str);
+
+        for (int num_threads : {1, 3, 8}) {
+            for (size_t limit : {(size_t) 100000, (size_t) 5}) {
+                size_t expect_limited = min(expect, limit);
+                size_t guesses;
+                size_t count = TdokuCountParallel(puzzle.c_str(), limit, num_threads, &guesses);
+                size_t num_enumerated = 0;
+                size_t enumerated = TdokuEnumerateParallel(
+                        puzzle.c_str(), limit, num_threads,
+                        [](const char *, void *arg) { (*(size_t *) arg)++; }, &num_enumerated);
+                bool this_fail = count != expect_limited || enumerated != expect_limited ||
+                                 num_enumerated != expect_limited;
+                if (this_fail || verbose) {
+                    cout << (this_fail ? "FAIL: " : "") << "tdoku_parallel\n"
+                         << "      puzzle:   " << puzzle << "\n"
+                         << "      threads:  " << num_threads << ", limit " << limit << "\n"
+                         << "      expected: " << expect_limited << "\n"
+                         << "      observed: " << count << ", " << enumerated << ", "
+                         << num_enumerated << endl;
+                }
+                fail |= this_fail;
+            }
+        }
+    }
+    file.close();
+    if (!fail) cout << "PASS: tdoku_parallel" << endl;
+}
+
+// checks that a search paused after every solution finds them all.
+void RunSuspended(const string &testdata_filename, bool verbose) {
+    ifstream file;
+    file.open(testdata_filename);
+    string line;
+    bool fail = false;
+    while (getline(file, line)) {
+        stringstream ss(line);
+        string puzzle, expect_str;
+        getline(ss, puzzle, ':');
+        getline(ss, expect_str, ':');
+        size_t expect = stoi(expect_str);
+
+        TdokuSearch *search = TdokuSearchCreate(puzzle.c_str());
+        char output[81];
+        size_t count = 0;
+        while (TdokuSearchNext(search, output, nullptr)) count++;
+        TdokuSearchDestroy(search);
+
+        bool this_fail = count != expect;
+        if (this_fail || verbose) {
+            cout << (this_fail ? "FAIL: " : "") << "tdoku_suspended\n"
+                 << "      puzzle:   " << puzzle << "\n"
+                 << "      expected: " << expect << "\n"
+                 << "      observed: " << count << endl;
+        }
+        fail |= this_fail;
+    }
+    file.close();
+    if (!fail) cout << "PASS: tdoku_suspended" << endl;
+}
+
+// checks that contexts with the same seed generate the same puzzles, the same as TdokuGenerate
+// with that seed, for vanilla and pencilmark puzzles.
+void RunSeededGeneration(bool verbose) {
+    const uint64_t seed = 11;
+    bool fail = false;
+    for (bool pencilmark : {false, true}) {
+        size_t num = pencilmark ? 4 : 40, stride = pencilmark ? 730 : 82;
+        vector<char> expect(num * stride), first(num * stride), second(num * stride);
+        size_t expect_count = TdokuGenerate(num, pencilmark, seed, expect.data(), '\n');
+        TdokuContext *context = TdokuContextCreate(seed);
+        size_t first_count = TdokuContextGenerate(context, num, pencilmark, first.data(), '\n');
+        TdokuContextDestroy(context);
+        context = TdokuContextCreate(seed);
+        size_t second_count = TdokuContextGenerate(context, num, pencilmark, second.data(), '\n');
+        TdokuContextDestroy(context);
+        size_t size = expect_count * stride;
+        bool this_fail = expect_count == 0 || first_count != expect_count ||
+                         second_count != expect_count ||
+                         memcmp(first.data(), expect.data(), size) != 0 ||
+                         memcmp(second.data(), expect.data(), size) != 0;
+        if (this_fail || verbose) {
+            cout << (this_fail ? "FAIL: " : "") << "tdoku_generate_seeded\n"
+                 << "      pencilmark: " << pencilmark << "\n"
+                 << "      expected:   " << expect_count << " puzzles\n"
+                 << "      observed:   " << first_count << " and " << second_count
+                 << " puzzles" << endl;
+        }
+        fail |= this_fail;
+    }
+    if (!fail) cout << "PASS: tdoku_generate_seeded" << endl;
+}
+
+// checks that parallel generation gives the same puzzles every time for a seed and thread
+// count, and on one thread the same puzzles as TdokuGenerate.
+void RunParallelGeneration(bool verbose) {
+    const uint64_t seed = 11;
+    const size_t num = 60;
+    bool fail = false;
+    vector<char> expect(num * 82);
+    size_t expect_count = TdokuGenerate(num, false, seed, expect.data(), '\n');
+    for (int num_threads : {1, 3}) {
+        vector<char> first(num * 82), second(num * 82);
+        size_t first_count = TdokuGenerateParallel(num, false, seed, num_threads, first.data(),
+                                                   '\n');
+        size_t second_count = TdokuGenerateParallel(num, false, seed, num_threads,
+                                                    second.data(), '\n');
+        bool this_fail = first_count == 0 || second_count != first_count ||
+                         memcmp(first.data(), second.data(), first_count * 82) != 0;
+        if (num_threads == 1) {
+            this_fail |= first_count != expect_count ||
+                         memcmp(first.data(), expect.data(), expect_count * 82) != 0;
+        }
+        if (this_fail || verbose) {
+            cout << (this_fail ? "FAIL: " : "") << "tdoku_generate_parallel\n"
+                 << "      threads:  " << num_threads << "\n"
+                 << "      expected: " << (num_threads == 1 ? expect_count : first_count)
+                 << " puzzles\n"
+                 << "      observed: " << first_count << " and " << second_count
+                 << " puzzles" << endl;
+        }
+        fail |= this_fail;
+    }
+    if (!fail) cout << "PASS: tdoku_generate_parallel" << endl;
+}
+
+// checks that streaming generation stops at each of its limits: after max_puzzles puzzles,
+// after max_attempts attempts (making the same puzzles as TdokuGenerate with that many), and
+// at the first attempt after max_seconds. with no limit it generates nothing.
+void RunStreamGeneration(bool verbose) {
+    const uint64_t seed = 11;
+    bool fail = false;
+    auto check = [&](const string &limits, bool this_fail, size_t count, double seconds) {
+        if (this_fail || verbose) {
+            cout << (this_fail ? "FAIL: " : "") << "tdoku_generate_stream\n"
+                 << "      limits:   " << limits << "\n"
+                 << "      observed: " << count << " puzzles in " << seconds << "s" << endl;
+        }
+        fail |= this_fail;
+    };
+    auto stream = [&](size_t max_puzzles, uint64_t max_attempts, double max_seconds,
+                      string *puzzles, double *seconds) {
+        auto start = chrono::steady_clock::now();
+        size_t count = TdokuGenerateStream(false, seed, max_puzzles, max_attempts, max_seconds,
+                                           [](const char *puzzle, void *puzzles) {
+            *(string *) puzzles += string(puzzle) + "\n";
+        }, puzzles);
+        *seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        return count;
+    };
+
+    string puzzles;
+    double seconds;
+    size_t count = stream(25, 0, 0.0, &puzzles, &seconds);
+    check("25 puzzles", count != 25 || puzzles.size() != 25 * 82, count, seconds);
+
+    const size_t max_attempts = 30;
+    vector<char> expect(max_attempts * 82);
+    size_t expect_count = TdokuGenerate(max_attempts, false, seed, expect.data(), '\n');
+    puzzles.clear();
+    count = stream(0, max_attempts, 0.0, &puzzles, &seconds);
+    check("30 attempts", count != expect_count ||
+                         puzzles != string(expect.data(), expect_count * 82), count, seconds);
+    puzzles.clear();
+    count = stream(1000, 3, 0.0, &puzzles, &seconds);
+    check("1000 puzzles or 3 attempts", count > 3, count, seconds);
+
+    const double max_seconds = 0.05;
+    puzzles.clear();
+    count = stream(0, 0, max_seconds, &puzzles, &seconds);
+    check("0.05s", count == 0 || seconds < max_seconds || seconds > max_seconds + 1.0, count,
+          seconds);
+
+    puzzles.clear();
+    count = stream(0, 0, 0.0, &puzzles, &seconds);
+    check("none", count != 0 || !puzzles.empty(), count, seconds);
+    if (!fail) cout << "PASS: tdoku_generate_stream" << endl;
+}
+
+// checks that a generator's pool, size included, survives serialization, that generators with
+// the same seed and a restored pool generate the same puzzles, and that a pool of the wrong kind
+// or a truncated one is refused without touching the pool.
+void RunGeneratorPool(bool verbose) {
+    auto serialize = [](const TdokuGenerator *generator) {
+        string pool(TdokuGeneratorSerialize(generator, nullptr, 0), ' ');
+        TdokuGeneratorSerialize(generator, &pool[0], pool.size());
+        return pool;
+    };
+    TdokuGenerator *source = TdokuGeneratorCreate(false, 16, 5);
+    vector<char> puzzles(30 * 82);
+    TdokuGeneratorGenerate(source, 30, puzzles.data(), '\n');
+    string pool = serialize(source);
+    TdokuGeneratorDestroy(source);
+
+    TdokuGenerator *first = TdokuGeneratorCreate(false, 0, 9);
+    TdokuGenerator *second = TdokuGeneratorCreate(false, 0, 9);
+    TdokuGenerator *pencilmark = TdokuGeneratorCreate(true, 0, 9);
+    bool restored = TdokuGeneratorDeserialize(first, pool.data(), pool.size()) &&
+                    TdokuGeneratorDeserialize(second, pool.data(), pool.size());
+    bool round_trip = serialize(first) == pool;
+    string pencilmark_pool = serialize(pencilmark);
+    bool refused = !TdokuGeneratorDeserialize(pencilmark, pool.data(), pool.size()) &&
+                   serialize(pencilmark) == pencilmark_pool &&
+                   !TdokuGeneratorDeserialize(first, pool.data(), pool.size() - 10) &&
+                   serialize(first) == pool;
+    vector<char> first_puzzles(10 * 82), second_puzzles(10 * 82);
+    size_t first_count = TdokuGeneratorGenerate(first, 10, first_puzzles.data(), '\n');
+    size_t second_count = TdokuGeneratorGenerate(second, 10, second_puzzles.data(), '\n');
+    bool same = first_count > 0 && first_count == second_count && first_puzzles == second_puzzles;
+    TdokuGeneratorDestroy(first);
+    TdokuGeneratorDestroy(second);
+    TdokuGeneratorDestroy(pencilmark);
+
+    bool fail = !restored || !round_trip || !refused || !same;
+    if (fail || verbose) {
+        cout << (fail ? "FAIL: " : "") << "tdoku_generator_pool\n"
+             << "      pool:     " << pool.substr(0, pool.find('\n')) << "\n"
+             << "      observed: restored " << restored << ", round trip " << round_trip
+             << ", refused " << refused << ", same puzzles " << same << endl;
+    }
+    if (!fail) cout << "PASS: tdoku_generator_pool" << endl;
+}
+
+// checks that masked generation only places clues the mask allows, keeps every group of
+// symmetric cells whole, and yields unique puzzles, for each symmetry.
+void RunMaskedGeneration(bool verbose) {
+    // no clues in the corners or the center, a layout that all symmetries map to itself.
+    string mask(81, 'x');
+    for (int cell : {0, 8, 40, 72, 80}) mask[cell] = '.';
+    const size_t num = 5;
+    bool fail = false;
+    for (int symmetry = 0; symmetry <= 4; symmetry++) {
+        vector<char> puzzles(num * 82);
+        size_t count = TdokuGenerateMasked(num, mask.c_str(), symmetry, 17, puzzles.data(),
+                                           '\n', nullptr);
+        for (size_t i = 0; i < count; i++) {
+            string puzzle(&puzzles[i * 82], 81);
+            bool fits = true;
+            for (int cell = 0; cell < 81; cell++) {
+                if (puzzle[cell] == '.') continue;
+                int image = SymmetricCell(cell, symmetry);
+                fits &= mask[cell] != '.' && (mask[image] == '.' || puzzle[image] != '.');
+            }
+            char solution[81];
+            size_t guesses;
+            bool unique = TdokuSolverDpllTriadSimd(puzzle.c_str(), 2, 0, solution, &guesses) == 1;
+            bool this_fail = !fits || !unique;
+            if (this_fail || verbose) {
+                cout << (this_fail ? "FAIL: " : "") << "tdoku_generate_masked\n"
+                     << "      symmetry: " << symmetry << "\n"
+                     << "      puzzle:   " << puzzle << "\n"
+                     << "      observed: fits " << fits << ", unique " << unique << endl;
+            }
+            fail |= this_fail;
+        }
+        if (count == 0) {
+            cout << "FAIL: tdoku_generate_masked\n"
+                 << "      symmetry: " << symmetry << "\n"
+                 << "      observed: no puzzles" << endl;
+            fail = true;
+        }
+    }
+    if (!fail) cout << "PASS: tdoku_generate_masked" << endl;
+}
+
+// a random puzzle equivalent to the given one, with its bands, rows within bands, stacks,
+// columns within stacks and digits permuted, and transposed half of the time.
+string RandomEquivalent(const string &puzzle, mt19937 &rng) {
+    auto permutation = [&](int n) {
+        vector<int> p(n);
+        iota(p.begin(), p.end(), 0);
+        shuffle(p.begin(), p.end(), rng);
+        return p;
+    };
+    int rows[9], cols[9];
+    vector<int> bands = permutation(3), stacks = permutation(3);
+    for (int b = 0; b < 3; b++) {
+        vector<int> band_rows = permutation(3), stack_cols = permutation(3);
+        for (int i = 0; i < 3; i++) {
+            rows[b * 3 + i] = bands[b] * 3 + band_rows[i];
+            cols[b * 3 + i] = stacks[b] * 3 + stack_cols[i];
+        }
+    }
+    vector<int> digits = permutation(9);
+    bool transpose = rng() & 1u;
+    string equivalent(81, '.');
+    for (int r = 0; r < 9; r++) {
+        for (int c = 0; c < 9; c++) {
+            char cell = puzzle[rows[r] * 9 + cols[c]];
+            if (cell >= '1' && cell <= '9') cell = (char) ('1' + digits[cell - '1']);
+            equivalent[transpose ? c * 9 + r : r * 9 + c] = cell;
+        }
+    }
+    return equivalent;
+}
+
+// the puzzles of the test data followed by the solutions given for them.
+vector<string> LoadPuzzlesAndGrids(const string &testdata_filename) {
+    ifstream file(testdata_filename);
+    vector<string> puzzles, grids;
+    string line;
+    while (getline(file, line)) {
+        stringstream ss(line);
+        string puzzle, expect_str, solution;
+        getline(ss, puzzle, ':');
+        getline(ss, expect_str, ':');
+        getline(ss, solution, ':');
+        puzzles.push_back(puzzle);
+        if (solution.size() >= 81) grids.push_back(solution.substr(0, 81));
+    }
+    puzzles.insert(puzzles.end(), grids.begin(), grids.end());
+    return puzzles;
+}
+
+// checks that minimizing a puzzle or grid keeps its solution and leaves a minimal puzzle, one
+// that has more than one solution without any of its clues. pencilmark clues are eliminated
+// candidates, so removing one puts the candidate back.
+void RunMinimize(const string &testdata_filename, bool verbose) {
+    vector<string> puzzles;
+    for (const string &puzzle : LoadPuzzlesAndGrids(testdata_filename)) {
+        char solution[81];
+        if (TdokuSolve(puzzle.c_str(), false, solution) == 1) puzzles.push_back(puzzle);
+    }
+    string grid = puzzles.back();
+    for (size_t i = 0; i < 3; i++) puzzles.push_back(Pencilmark(puzzles[i]));
+    puzzles.push_back(Pencilmark(grid));
+    // a seeded context makes the order in which clues are tested, and so the result, the same
+    // on every run.
+    TdokuContext *context = TdokuContextCreate(1);
+    bool fail = false;
+    for (const string &puzzle : puzzles) {
+        bool pencilmark = puzzle.size() == 729;
+        char expect_solution[81], solution[81];
+        size_t guesses;
+        TdokuSolverDpllTriadSimd(puzzle.c_str(), 1, 0, expect_solution, &guesses);
+        for (bool monotonic : {false, true}) {
+            string minimized = puzzle;
+            if (!TdokuContextMinimize(context, pencilmark, monotonic, &minimized[0])) continue;
+            bool this_fail =
+                    TdokuSolverDpllTriadSimd(minimized.c_str(), 2, 1, solution, &guesses) != 1 ||
+                    strncmp(solution, expect_solution, 81) != 0;
+            int not_required = -1;
+            for (size_t i = 0; i < minimized.size() && not_required < 0; i++) {
+                bool is_clue = pencilmark ? minimized[i] == '.' : minimized[i] != '.';
+                if (!is_clue) continue;
+                string removed = minimized;
+                removed[i] = pencilmark ? (char) ('1' + i % 9) : '.';
+                if (TdokuSolverDpllTriadSimd(removed.c_str(), 2, 0, solution, &guesses) < 2) {
+                    not_required = (int) i;
+                }
+            }
+            this_fail |= not_required >= 0;
+            if (this_fail || verbose) {
+                cout << (this_fail ? "FAIL: " : "") << "tdoku_minimize\n"
+                     << "      puzzle:    " << puzzle << "\n"
+                     << "      minimized: " << minimized << "\n"
+                     << "      monotonic: " << monotonic << ", clue not required: "
+                     << not_required << endl;
+            }
+            fail |= this_fail;
+        }
+    }
+    TdokuContextDestroy(context);
+    if (!fail) cout << "PASS: tdoku_minimize" << endl;
+}
+
+// checks that puzzles and grids canonicalize the same as random equivalents of themselves, and
+// that the transform maps each to its canonical form and back.
+void RunCanonical(const string &testdata_filename, bool verbose) {
+    mt19937 rng(1);
+    bool fail = false;
+    for (const string &puzzle : LoadPuzzlesAndGrids(testdata_filename)) {
+        char canonical[81], transformed[81], restored[81];
+        uint8_t transform[28];
+        TdokuCanonicalize(puzzle.c_str(), canonical, transform);
+        TdokuTransform(puzzle.c_str(), transform, false, transformed);
+        TdokuTransform(canonical, transform, true, restored);
+        bool this_fail = strncmp(canonical, transformed, 81) != 0 ||
+                         strncmp(puzzle.c_str(), restored, 81) != 0;
+        for (int i = 0; i < 20; i++) {
+            string equivalent = RandomEquivalent(puzzle, rng);
+            char equivalent_canonical[81];
+            TdokuCanonicalize(equivalent.c_str(), equivalent_canonical, nullptr);
+            this_fail |= strncmp(canonical, equivalent_canonical, 81) != 0;
+        }
+        if (this_fail || verbose) {
+            cout << (this_fail ? "FAIL: " : "") << "tdoku_canonical\n"
+                 << "      puzzle:    " << puzzle << "\n"
+                 << "      canonical: " << string(canonical, 81) << endl;
+        }
+        fail |= this_fail;
+    }
+    if (!fail) cout << "PASS: tdoku_canonical" << endl;
+}
+
+// checks that deduplication rejects a puzzle equivalent to one already generated. a pool of a
+// puzzle and a random equivalent of it, with no clues dropped, makes every attempt return one
+// of the two, so all are kept without deduplication and only the first with it. also checks
+// that scored generation deduplicates when its options ask for it.
+void RunDedup(const string &testdata_filename, bool verbose) {
+    string puzzle;
+    for (const string &p : LoadPuzzles(testdata_filename)) {
+        char solution[81];
+        if (TdokuSolve(p.c_str(), false, solution) == 1) {
+            puzzle = p;
+            break;
+        }
+    }
+    mt19937 rng(1);
+    string equivalent;
+    do {
+        equivalent = RandomEquivalent(puzzle, rng);
+    } while (equivalent == puzzle);
+    string pool = "tdoku-pool 1 0 2\n" + puzzle + " 0\n" + equivalent + " 0\n";
+
+    GenerateOptions9x9 options;
+    TdokuGenerateOptionsDefault(&options);
+    options.clues_to_drop = 0;
+    const size_t num = 20;
+    vector<GenerateOut9x9> output(num);
+    bool fail = false;
+    auto check = [&](const string &what, size_t expect, size_t count) {
+        bool this_fail = count != expect;
+        if (this_fail || verbose) {
+            cout << (this_fail ? "FAIL: " : "") << "tdoku_dedup\n"
+                 << "      check:    " << what << "\n"
+                 << "      expected: " << expect << "\n"
+                 << "      observed: " << count << endl;
+        }
+        fail |= this_fail;
+    };
+
+    TdokuGenerator *generator = TdokuGeneratorCreate(false, 0, 1);
+    TdokuGeneratorDeserialize(generator, pool.data(), pool.size());
+    size_t count = TdokuGeneratorGenerateScored(generator, num, &options, output.data());
+    check("puzzles without dedup", num, count);
+    set<string> seen;
+    for (size_t i = 0; i < count; i++) seen.emplace(output[i].data, 81);
+    check("distinct puzzles without dedup", 2, seen.size());
+    TdokuGeneratorSetDedup(generator, 1u << 12u);
+    count = TdokuGeneratorGenerateScored(generator, num, &options, output.data());
+    check("puzzles with dedup", 1, count);
+    check("duplicates with dedup", num - 1, TdokuGeneratorNumDuplicates(generator));
+    TdokuGeneratorDestroy(generator);
+
+    options.dedup_bytes = 1u << 12u;
+    count = TdokuGenerateScored(num, &options, 1, output.data());
+    check("scored puzzles with dedup", 1, count);
+    if (!fail) cout << "PASS: tdoku_dedup" << endl;
+}
+
+// checks that the cache returns TdokuSolve's results for a puzzle and for a transposed and
+// relabeled copy of it, that the copy hits, and that the least recently used entry is evicted.
+void RunCache(const string &testdata_filename, bool verbose) {
+    vector<string> puzzles;
+    ifstream file(testdata_filename);
+    string line;
+    while (getline(file, line) && puzzles.size() < 3) {
+        if (line.compare(81, 3, ":1:") == 0) puzzles.push_back(line.substr(0, 81));
+    }
+    string variant(81, '.');
+    for (int r = 0; r < 9; r++) {
+        for (int c = 0; c < 9; c++) {
+            char cell = puzzles[0][c * 9 + r];
+            variant[r * 9 + c] = cell == '.' ? '.' : (char) ('1' + '9' - cell);
+        }
+    }
+
+    TdokuCache *cache = TdokuCacheCreate(2);
+    bool fail = false;
+    uint64_t hits, misses;
+    auto check = [&](const string &puzzle, uint64_t expect_hits, uint64_t expect_misses) {
+        char expect_solution[81], solution[81];
+        size_t expect = TdokuSolve(puzzle.c_str(), false, expect_solution);
+        size_t count = TdokuCacheSolve(cache, puzzle.c_str(), false, solution);
+        TdokuCacheStats(cache, &hits, &misses);
+        bool this_fail = count != expect || strncmp(solution, expect_solution, 81) != 0 ||
+                         hits != expect_hits || misses != expect_misses;
+        if (this_fail || verbose) {
+            cout << (this_fail ? "FAIL: " : "") << "tdoku_cache\n"
+                 << "      puzzle:   " << puzzle << "\n"
+                 << "      expected: " << expect << " " << string(expect_solution, 81)
+                 << ", hits " << expect_hits << ", misses " << expect_misses << "\n"
+                 << "      observed: " << count << " " << string(solution, 81)
+                 << ", hits " << hits << ", misses " << misses << endl;
+        }
+        fail |= this_fail;
+    };
+    check(puzzles[0], 0, 1);
+    check(variant, 1, 1);
+    check(puzzles[1], 1, 2);
+    check(puzzles[2], 1, 3); // evicts puzzles[0], the least recently used
+    check(puzzles[1], 2, 3);
+    check(variant, 2, 4);    // evicts puzzles[2]
+    check(puzzles[2], 2, 5);
+    TdokuCacheDestroy(cache);
+    if (!fail) cout << "PASS: tdoku_cache" << endl;
+}
+
+// checks that seeded ratings don't depend on the number of threads, and that rating a batch
+// gives the same ratings as rating its puzzles one at a time.
+void RunSeededRating(const string &testdata_filename, bool verbose) {
+    vector<string> puzzles = LoadPuzzles(testdata_filename);
+    string joined;
+    for (const string &puzzle : puzzles) joined += puzzle;
+    const int num_evals = 40;
+    const uint64_t seed = 7;
+    vector<int> batch_ratings(puzzles.size());
+    TdokuRateBatch(joined.data(), puzzles.size(), 81, false, 0, num_evals, seed, 3,
+                   batch_ratings.data());
+
+    bool fail = false;
+    for (size_t i = 0; i < puzzles.size(); i++) {
+        int rating = TdokuRateSeeded(puzzles[i].c_str(), false, 0, num_evals, seed, 1);
+        int threaded_rating = TdokuRateSeeded(puzzles[i].c_str(), false, 0, num_evals, seed, 3);
+        bool this_fail = threaded_rating != rating || batch_ratings[i] != rating;
+        if (this_fail || verbose) {
+            cout << (this_fail ? "FAIL: " : "") << "tdoku_rate_seeded\n"
+                 << "      puzzle:   " << puzzles[i] << "\n"
+                 << "      observed: " << rating << " on 1 thread, " << threaded_rating
+                 << " on 3, " << batch_ratings[i] << " in a batch" << endl;
+        }
+        fail |= this_fail;
+    }
+    if (!fail) cout << "PASS: tdoku_rate_seeded" << endl;
+}
+
+// checks that an adaptive rating held to a fixed number of evaluations draws the same ones as
+// the seeded rating, and so gives the same rating, and that one allowed to stop early reports an
+// interval holding the rating of all the evaluations.
+void RunAdaptiveRating(const string &testdata_filename, bool verbose) {
+    const int num_evals = 40;
+    const uint64_t seed = 7;
+    bool fail = false;
+    for (const string &puzzle : LoadPuzzles(testdata_filename)) {
+        int expect = TdokuRateSeeded(puzzle.c_str(), false, 0, num_evals, seed, 1);
+        int evals = 0;
+        int rating = TdokuRateAdaptive(puzzle.c_str(), false, 0, num_evals, num_evals, 0.0, seed,
+                                       nullptr, nullptr, &evals);
+        bool this_fail = rating != expect || evals != num_evals;
+        if (this_fail || verbose) {
+            cout << (this_fail ? "FAIL: " : "") << "tdoku_rate_adaptive\n"
+                 << "      puzzle:   " << puzzle << "\n"
+                 << "      expected: " << expect << " in " << num_evals << " evals\n"
+                 << "      observed: " << rating << " in " << evals << " evals" << endl;
+        }
+        fail |= this_fail;
+    }
+
+    // with a loose tolerance the rating stops early, and its interval holds the rating the
+    // seeded rating settles on with all the evaluations.
+    const int min_evals = 4, max_evals = 400;
+    const double tolerance = 20.0;
+    bool stopped_early = false;
+    for (const string &puzzle : LoadPuzzles(testdata_filename)) {
+        int expect = TdokuRateSeeded(puzzle.c_str(), false, 0, max_evals, seed, 1);
+        int low = 0, high = 0, evals = 0;
+        int rating = TdokuRateAdaptive(puzzle.c_str(), false, 0, min_evals, max_evals, tolerance,
+                                       seed, &low, &high, &evals);
+        stopped_early |= evals < max_evals;
+        bool this_fail = evals < min_evals || evals > max_evals || rating < low ||
+                         rating > high || expect < low || expect > high;
+        if (this_fail || verbose) {
+            cout << (this_fail ? "FAIL: " : "") << "tdoku_rate_adaptive\n"
+                 << "      puzzle:   " << puzzle << "\n"
+                 << "      expected: " << expect << " in " << max_evals << " evals\n"
+                 << "      observed: " << rating << " in [" << low << ", " << high << "] in "
+                 << evals << " evals" << endl;
+        }
+        fail |= this_fail;
+    }
+    if (!stopped_early) {
+        cout << "FAIL: tdoku_rate_adaptive\n"
+             << "      observed: no puzzle stopped before " << max_evals << " evals" << endl;
+        fail = true;
+    }
+    if (!fail) cout << "PASS: tdoku_rate_adaptive" << endl;
+}
+
+// checks grids looked up through the grid index and through skip indexes of every step against
+// the order in which the patterns enumerate them, for a table of the first few patterns. the
+// patterns don't fill a multiple of 8 counts, so scans end in a partial block.
+void RunGridLib(bool verbose) {
+    const int num_patterns = 43;
+    vector<uint16_t> counts(num_patterns);
+    vector<vector<string>> pattern_grids(num_patterns);
+    for (int p = 0; p < num_patterns; p++) {
+        // leave a few patterns out of the table, to be skipped by the lookups.
+        if (p == 5 || p == 15 || p == 16) continue;
+        char pattern[82];
+        GetPattern(p, pattern);
+        TdokuEnumerate(pattern, 100000, [](const char *grid, void *grids) {
+            ((vector<string> *) grids)->emplace_back(grid, 81);
+        }, &pattern_grids[p]);
+        counts[p] = (uint16_t) pattern_grids[p].size();
+    }
+    // the table holds fewer than 2^20 grids, so the grid index has one entry, for grid 0.
+    char index[6]{};
+
+    // grid ids with the grids expected for them: the first, middle and last grids of each
+    // pattern, and separately the first four, which a batch gets from one enumeration rather
+    // than a search each.
+    struct Lookups {
+        vector<size_t> grid_ids;
+        vector<string> grids;
+    } spread, first;
+    size_t num_grids = 0;
+    for (int p = 0; p < num_patterns; p++) {
+        for (size_t offset : {(size_t) 0, (size_t) counts[p] / 2, (size_t) counts[p] - 1}) {
+            if (offset >= counts[p]) continue;
+            spread.grid_ids.push_back(num_grids + offset);
+            spread.grids.push_back(pattern_grids[p][offset]);
+        }
+        for (size_t offset = 0; offset < 4 && offset < counts[p]; offset++) {
+            first.grid_ids.push_back(num_grids + offset);
+            first.grids.push_back(pattern_grids[p][offset]);
+        }
+        num_grids += counts[p];
+    }
+    // batches come back in the order requested, so shuffle them, and repeat an id.
+    mt19937 rng(1);
+    for (Lookups *lookups : {&spread, &first}) {
+        vector<size_t> &grid_ids = lookups->grid_ids;
+        vector<string> &grids = lookups->grids;
+        grid_ids.push_back(grid_ids[grid_ids.size() / 2]);
+        grids.push_back(grids[grids.size() / 2]);
+        for (size_t i = grid_ids.size() - 1; i > 0; i--) {
+            size_t j = rng() % (i + 1);
+            swap(grid_ids[i], grid_ids[j]);
+            swap(grids[i], grids[j]);
+        }
+    }
+
+    bool fail = false;
+    auto check = [&](const string &lookup, size_t grid_id, const string &expect,
+                     const char *grid) {
+        bool this_fail = strncmp(expect.c_str(), grid, 81) != 0;
+        if (this_fail || verbose) {
+            cout << (this_fail ? "FAIL: " : "") << "grid_lib\n"
+                 << "      lookup:   " << lookup << " of grid " << grid_id << "\n"
+                 << "      expected: " << expect << "\n"
+                 << "      observed: " << string(grid, 81) << endl;
+        }
+        fail |= this_fail;
+    };
+    char grid[81];
+    for (size_t i = 0; i < spread.grid_ids.size(); i++) {
+        GetGrid(spread.grid_ids[i], index, counts.data(), grid);
+        check("GetGrid", spread.grid_ids[i], spread.grids[i], grid);
+    }
+    for (int log2_step = 0; log2_step <= 14; log2_step++) {
+        GridSkipIndex *skip_index = GridSkipIndexCreate(counts.data(), num_patterns, log2_step);
+        string lookup = "GetGridSkipIndexed with step 2^" + to_string(log2_step);
+        if (GridSkipIndexNumGrids(skip_index) != num_grids) {
+            cout << "FAIL: grid_lib\n"
+                 << "      lookup:   GridSkipIndexNumGrids with step 2^" << log2_step << "\n"
+                 << "      expected: " << num_grids << "\n"
+                 << "      observed: " << GridSkipIndexNumGrids(skip_index) << endl;
+            fail = true;
+        }
+        for (size_t i = 0; i < spread.grid_ids.size(); i++) {
+            GetGridSkipIndexed(spread.grid_ids[i], skip_index, grid);
+            check(lookup, spread.grid_ids[i], spread.grids[i], grid);
+        }
+        lookup = "GetGridsSkipIndexed with step 2^" + to_string(log2_step);
+        for (const Lookups *lookups : {&spread, &first}) {
+            const vector<size_t> &grid_ids = lookups->grid_ids;
+            vector<char> grids(grid_ids.size() * 81);
+            GetGridsSkipIndexed(grid_ids.data(), grid_ids.size(), skip_index, grids.data());
+            for (size_t i = 0; i < grid_ids.size(); i++) {
+                check(lookup, grid_ids[i], lookups->grids[i], &grids[i * 81]);
+            }
+        }
+        GridSkipIndexDestroy(skip_index);
+    }
+    if (!fail) cout << "PASS: grid_lib" << endl;
+}
+
+// checks that the SIMD level named by the TDOKU_SIMD environment variable is the one in use, as
+// the DISPATCH build's tests force each variant this way and rerun everything. a level the CPU
+// lacks can't be forced, so it's skipped.
+void RunSimdLevel(bool verbose) {
+    const char *requested = getenv("TDOKU_SIMD");
+    if (!requested) return;
+    __builtin_cpu_init();
+    bool supported = true;
+    if (!strcmp(requested, "sse4.1")) {
+        supported = __builtin_cpu_supports("sse4.1");
+    } else if (!strcmp(requested, "avx2")) {
+        supported = __builtin_cpu_supports("avx2");
+    } else if (!strcmp(requested, "avx512")) {
+        supported = __builtin_cpu_supports("avx512vl") && __builtin_cpu_supports("avx512bw") &&
+                    __builtin_cpu_supports("avx512bitalg");
+    }
+    if (!supported) {
+        cout << "SKIP: tdoku_simd_level (" << requested << " is not supported)" << endl;
+        return;
+    }
+    bool fail = strcmp(requested, TdokuSimdLevel()) != 0;
+    if (fail || verbose) {
+        cout << (fail ? "FAIL: " : "") << "tdoku_simd_level\n"
+             << "      expected: " << requested << "\n"
+             << "      observed: " << TdokuSimdLevel() << endl;
+    }
+    if (!fail) cout << "PASS: tdoku_simd_level" << endl;
+}
+
 int main(int argc, char **argv) {
     bool verbose = false;
     string testdata_filename = "test/test_puzzles";
@@ -70,8 +908,24 @@ int main(int argc, char **argv) {
         }
     }
 
+    RunSimdLevel(verbose);
     auto solvers = GetAllSolvers();
     for (auto &solver : solvers) {
         Run(testdata_filename, solver, verbose);
     }
+    RunBatch(testdata_filename, verbose);
+    RunParallel(testdata_filename, verbose);
+    RunSuspended(testdata_filename, verbose);
+    RunSeededGeneration(verbose);
+    RunParallelGeneration(verbose);
+    RunStreamGeneration(verbose);
+    RunMinimize(testdata_filename, verbose);
+    RunGeneratorPool(verbose);
+    RunMaskedGeneration(verbose);
+    RunCanonical(testdata_filename, verbose);
+    RunDedup(testdata_filename, verbose);
+    RunCache(testdata_filename, verbose);
+    RunSeededRating(testdata_filename, verbose);
+    RunAdaptiveRating(testdata_filename, verbose);
+    RunGridLib(verbose);
 }